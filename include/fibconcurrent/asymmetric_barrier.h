@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _ASYMMETRIC_BARRIER_H_
+#define _ASYMMETRIC_BARRIER_H_
+
+/*
+    Description: A store-load barrier split into a cheap half and an
+                 expensive half. The light barrier is used on hot paths and
+                 is only a compiler barrier once membarrier() with
+                 MEMBARRIER_CMD_PRIVATE_EXPEDITED is registered. The heavy
+                 barrier is used on the rare path and issues the membarrier()
+                 system call, which runs a full barrier on every CPU running
+                 a thread of this process. A light barrier paired with a
+                 heavy barrier orders stores before loads on both sides
+                 (Dekker style). If membarrier() is not available, both
+                 halves fall back to a full fence.
+
+                 The expedited mode is opt-in and process wide. Call
+                 asymmetric_barrier_init() once at startup, before any other
+                 thread uses a light or heavy barrier. Switching modes while
+                 other threads run isn't safe: a thread could see the new
+                 mode and issue only a compiler barrier while another thread
+                 still sees the old mode and issues only a local fence.
+                 Nothing in this library calls it implicitly.
+*/
+
+#include <fibconcurrent/arch.h>
+#include <fibconcurrent/machine_specific.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//non-zero once the expedited membarrier() is registered for this process
+extern volatile int asymmetric_barrier_expedited;
+
+//register the process for expedited membarrier(). idempotent; returns 1 if the light barrier is a compiler barrier.
+//call before starting the threads which use the barriers (see above)
+extern int asymmetric_barrier_init();
+
+extern void asymmetric_barrier_heavy();
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline void asymmetric_barrier_light()
+{
+    if(asymmetric_barrier_expedited) {
+        __asm__ __volatile__ ("" : : : "memory");
+    } else {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+}
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _BYTE_RING_BUFFER_H_
+#define _BYTE_RING_BUFFER_H_
+
+/*
+    Description: A bounded ring of variable-length byte records. A producer
+                 reserves space, writes the record in place and commits it;
+                 the consumer reads records in place and releases them. The
+                 data area is one memfd (or shm) object mapped twice
+                 back-to-back, so a record which crosses the end of the
+                 buffer is still contiguous in memory and never split.
+
+                 byte_ring_buffer_reserve() is for a single producer and is
+                 wait free. byte_ring_buffer_reserve_mp() is for multiple
+                 producers: reservations are serialized by a busy bit in
+                 tail which is held for two stores, commits are lock free and
+                 can happen out of order. The consumer stops at the first
+                 uncommitted record. Only one reserve flavor may be used on a
+                 given buffer.
+
+    Properties: 1. Strict FIFO (reservation order)
+                2. Zero copy
+                3. Bounded (capacity is a power of 2 and a multiple of the page size)
+*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "arch.h"
+#include "machine_specific.h"
+
+#define BYTE_RING_BUFFER_ALIGN (8)
+#define BYTE_RING_BUFFER_BUSY ((uint64_t)1)//tail is being advanced by a producer (reserve_mp only)
+#define BYTE_RING_BUFFER_COMMITTED ((uint32_t)1 << 31)
+
+typedef struct byte_ring_buffer_record
+{
+    uint32_t stride;//bytes from this header to the next one
+    volatile uint32_t state;//BYTE_RING_BUFFER_COMMITTED | length once committed, 0 before
+} byte_ring_buffer_record_t;
+
+typedef struct byte_ring_buffer
+{
+    //written by producers
+    volatile uint64_t tail;
+    uint64_t head_cache;//the producer's copy of head (reserve only)
+    char _cache_padding1[CACHE_LINE_SIZE - 2 * sizeof(uint64_t)];
+    //written by the consumer
+    volatile uint64_t head;//everything before head is released
+    uint64_t read_pos;//records between head and read_pos are read but not released
+    uint64_t tail_cache;//the consumer's copy of tail
+    char _cache_padding2[CACHE_LINE_SIZE - 3 * sizeof(uint64_t)];
+    uint8_t* base;//capacity bytes, mapped twice
+    uint64_t capacity;
+    uint64_t mask;
+    int fd;
+} byte_ring_buffer_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BYTE_RING_BUFFER_MAX_CAPACITY ((size_t)1 << (sizeof(size_t) * 8 - 2))
+
+//capacity is rounded up to a power of 2 which is a multiple of the page size.
+//returns NULL if capacity is above BYTE_RING_BUFFER_MAX_CAPACITY
+extern byte_ring_buffer_t* byte_ring_buffer_create(size_t capacity);
+
+extern void byte_ring_buffer_destroy(byte_ring_buffer_t* rb);
+
+static inline size_t byte_ring_buffer_capacity(const byte_ring_buffer_t* rb)
+{
+    assert(rb);
+    return (size_t)rb->capacity;
+}
+
+//the largest length which can ever be reserved
+static inline size_t byte_ring_buffer_max_record(const byte_ring_buffer_t* rb)
+{
+    uint64_t max;
+    assert(rb);
+    max = rb->capacity - sizeof(byte_ring_buffer_record_t);
+    return max < BYTE_RING_BUFFER_COMMITTED ? (size_t)max : (size_t)(BYTE_RING_BUFFER_COMMITTED - 1);
+}
+
+static inline uint64_t byte_ring_buffer_stride(size_t len)
+{
+    return ((uint64_t)len + sizeof(byte_ring_buffer_record_t) + BYTE_RING_BUFFER_ALIGN - 1) & ~(uint64_t)(BYTE_RING_BUFFER_ALIGN - 1);
+}
+
+static inline void* byte_ring_buffer_write_header(byte_ring_buffer_t* rb, uint64_t pos, uint64_t stride)
+{
+    byte_ring_buffer_record_t* const hdr = (byte_ring_buffer_record_t*)(rb->base + (pos & rb->mask));
+    hdr->stride = (uint32_t)stride;
+    hdr->state = 0;
+    return hdr + 1;
+}
+
+//single producer only! returns a pointer to len contiguous bytes, or NULL if the buffer is full
+static inline void* byte_ring_buffer_reserve(byte_ring_buffer_t* rb, size_t len)
+{
+    uint64_t tail, stride;
+    void* ret;
+    assert(rb);
+    assert(len <= byte_ring_buffer_max_record(rb));
+    stride = byte_ring_buffer_stride(len);
+    tail = rb->tail;
+    if(rb->capacity - (tail - rb->head_cache) < stride) {
+        rb->head_cache = __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE);
+        if(rb->capacity - (tail - rb->head_cache) < stride) {
+            return NULL;
+        }
+    }
+    ret = byte_ring_buffer_write_header(rb, tail, stride);
+    __atomic_store_n(&rb->tail, tail + stride, __ATOMIC_RELEASE);
+    return ret;
+}
+
+//multiple producers. returns a pointer to len contiguous bytes, or NULL if the buffer is full
+static inline void* byte_ring_buffer_reserve_mp(byte_ring_buffer_t* rb, size_t len)
+{
+    uint64_t tail, stride;
+    void* ret;
+    assert(rb);
+    assert(len <= byte_ring_buffer_max_record(rb));
+    stride = byte_ring_buffer_stride(len);
+    while(1) {
+        tail = __atomic_load_n(&rb->tail, __ATOMIC_RELAXED);
+        if(tail & BYTE_RING_BUFFER_BUSY) {
+            cpu_relax();//another producer is writing its header
+            continue;
+        }
+        if(rb->capacity - (tail - __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE)) < stride) {
+            return NULL;
+        }
+        if(__atomic_compare_exchange_n(&rb->tail, &tail, tail | BYTE_RING_BUFFER_BUSY, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    //the header must be written before the consumer can see the record below tail
+    ret = byte_ring_buffer_write_header(rb, tail, stride);
+    __atomic_store_n(&rb->tail, tail + stride, __ATOMIC_RELEASE);
+    return ret;
+}
+
+//data is a pointer returned by reserve; len may be less than the reserved length
+static inline void byte_ring_buffer_commit(byte_ring_buffer_t* rb, void* data, size_t len)
+{
+    byte_ring_buffer_record_t* const hdr = (byte_ring_buffer_record_t*)data - 1;
+    (void) rb;
+    assert(data);
+    assert(byte_ring_buffer_stride(len) <= hdr->stride);
+    __atomic_store_n(&hdr->state, BYTE_RING_BUFFER_COMMITTED | (uint32_t)len, __ATOMIC_RELEASE);
+}
+
+//consumer only! returns the next committed record and its length, or NULL if there is none.
+//the record stays valid until byte_ring_buffer_release() is called
+static inline void* byte_ring_buffer_read(byte_ring_buffer_t* rb, size_t* len)
+{
+    byte_ring_buffer_record_t* hdr;
+    uint64_t pos;
+    uint32_t state;
+    assert(rb);
+    assert(len);
+    pos = rb->read_pos;
+    if(pos == rb->tail_cache) {
+        rb->tail_cache = __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE) & ~BYTE_RING_BUFFER_BUSY;
+        if(pos == rb->tail_cache) {
+            return NULL;
+        }
+    }
+    hdr = (byte_ring_buffer_record_t*)(rb->base + (pos & rb->mask));
+    state = __atomic_load_n(&hdr->state, __ATOMIC_ACQUIRE);
+    if(!(state & BYTE_RING_BUFFER_COMMITTED)) {
+        return NULL;//reserved but not committed yet
+    }
+    rb->read_pos = pos + hdr->stride;
+    *len = state & ~BYTE_RING_BUFFER_COMMITTED;
+    return hdr + 1;
+}
+
+//consumer only! gives the space of every record read so far back to the producers
+static inline void byte_ring_buffer_release(byte_ring_buffer_t* rb)
+{
+    assert(rb);
+    __atomic_store_n(&rb->head, rb->read_pos, __ATOMIC_RELEASE);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef _EBR_H_
+#define _EBR_H_
+
+/*
+    Description: Epoch based reclamation (Fraser, "Practical lock-freedom").
+                 A thread brackets its accesses to shared nodes with
+                 ebr_enter() and ebr_exit(). Entering stores the current
+                 global epoch in the thread's record. Retired nodes go onto
+                 one of three limbo lists, chosen by the global epoch at the
+                 time of retirement. The global epoch advances only once
+                 every thread inside a critical section has seen the current
+                 epoch. A node retired in epoch e is freed once the epoch
+                 reaches e + 2, since no thread can still hold a reference to
+                 it by then.
+
+                 Enter is a single store to the thread's own record plus
+                 asymmetric_barrier_light(). Advancing the epoch issues
+                 asymmetric_barrier_heavy() (see asymmetric_barrier.h). A
+                 thread which stalls inside a critical section blocks all
+                 reclamation; hazard pointers (hazard_pointer.h) don't have
+                 that problem.
+
+                 Nodes are hazard_node_t, so a structure can support either
+                 scheme (see reclaim.h).
+
+    Properties: 1. Read side cost is independent of the number of pointers
+                   protected
+                2. Bounded garbage only while no thread stalls in a critical
+                   section
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include <fibconcurrent/arch.h>
+#include <fibconcurrent/hazard_pointer.h>
+#include <fibconcurrent/asymmetric_barrier.h>
+
+//try to advance the epoch after this many retirements
+#ifndef EBR_RETIRE_THRESHOLD
+#define EBR_RETIRE_THRESHOLD 64
+#endif
+
+#define EBR_LIMBO_LISTS 3
+
+//a thread's local_epoch is (epoch << 1) | EBR_ACTIVE while inside a critical section, 0 otherwise
+#define EBR_ACTIVE ((uint64_t)1)
+
+struct ebr_thread_record;
+
+typedef struct ebr
+{
+    volatile uint64_t epoch;
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(uint64_t)];
+    struct ebr_thread_record* volatile head;
+} ebr_t;
+
+typedef struct ebr_thread_record
+{
+    volatile uint64_t local_epoch;//read by other threads advancing the epoch
+    struct ebr_thread_record* next;
+    ebr_t* ebr;
+    size_t nesting;
+    size_t retired_count;
+    hazard_node_t* limbo[EBR_LIMBO_LISTS];
+    uint64_t limbo_epoch[EBR_LIMBO_LISTS];//the epoch the nodes in limbo[i] were retired in
+    char _cache_padding1[CACHE_LINE_SIZE];
+} ebr_thread_record_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void ebr_init(ebr_t* ebr);
+
+//create a new record and fuse it into ebr's list of records
+extern ebr_thread_record_t* ebr_thread_record_create_and_push(ebr_t* ebr);
+
+//free all retired nodes and all records. no thread may be using ebr.
+extern void ebr_destroy(ebr_t* ebr);
+
+//advance the global epoch if every thread in a critical section has seen it, then free this thread's limbo lists which are old enough. returns 1 if the epoch advanced.
+extern int ebr_collect(ebr_thread_record_t* rec);
+
+//critical sections nest
+static inline void ebr_enter(ebr_thread_record_t* rec)
+{
+    assert(rec);
+    if(!rec->nesting++) {
+        const uint64_t epoch = __atomic_load_n(&rec->ebr->epoch, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&rec->local_epoch, (epoch << 1) | EBR_ACTIVE, __ATOMIC_RELAXED);
+        asymmetric_barrier_light();//the epoch store must be visible before we load shared pointers; pairs with the heavy barrier in ebr_collect()
+    }
+}
+
+static inline void ebr_exit(ebr_thread_record_t* rec)
+{
+    assert(rec);
+    assert(rec->nesting);
+    if(!--rec->nesting) {
+        __atomic_store_n(&rec->local_epoch, 0, __ATOMIC_RELEASE);
+    }
+}
+
+static inline void ebr_free_list(hazard_node_t* node)
+{
+    while(node) {
+        hazard_node_t* const next = node->next;
+        assert(node->gc_function);
+        node->gc_function(node->gc_data, node);
+        node = next;
+    }
+}
+
+//call this when an unlinked node should be cleaned up
+static inline void ebr_retire(ebr_thread_record_t* rec, hazard_node_t* node)
+{
+    uint64_t epoch;
+    size_t index;
+    assert(rec);
+    assert(node);
+    epoch = __atomic_load_n(&rec->ebr->epoch, __ATOMIC_SEQ_CST);
+    index = epoch % EBR_LIMBO_LISTS;
+    if(rec->limbo_epoch[index] != epoch) {
+        //the list holds nodes from epoch - 3 or earlier, which are safe to free
+        hazard_node_t* const old = rec->limbo[index];
+        rec->limbo[index] = NULL;
+        rec->limbo_epoch[index] = epoch;
+        ebr_free_list(old);
+    }
+    node->next = rec->limbo[index];
+    rec->limbo[index] = node;
+    if(++rec->retired_count >= EBR_RETIRE_THRESHOLD) {
+        rec->retired_count = 0;
+        ebr_collect(rec);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
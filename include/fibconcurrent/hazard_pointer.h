@@ -37,12 +37,16 @@
         -lower R means we'll scan more often but free nodes sooner
         -picking R > 2 * H means we'll free at least 0.5 R nodes per scan (hence BigTheta(R))
     -at any given time, up to a maximum of N * R retired nodes that cannot be reused
+    -records are never unlinked. a thread which is done releases its record; the next thread to call create_and_push() takes it over, so N counts records rather than threads ever seen
+    -using() needs its store to be visible before it re-reads the pointer, and scan() needs to see that store. using() issues asymmetric_barrier_light() and scan() issues asymmetric_barrier_heavy() once. by default both are full fences; after asymmetric_barrier_init() (call it before threads start using hazard pointers) using() is only a compiler barrier and scan() pays for a membarrier() system call instead
+    -retired nodes which are still hazardous when a record is released become orphans of that record. they're adopted by the next thread to take over the record or by any thread's scan()
 */
 
 #include <stddef.h>
 #include <assert.h>
 #include <fibconcurrent/arch.h>
 #include <fibconcurrent/machine_specific.h>
+#include <fibconcurrent/asymmetric_barrier.h>
 
 struct hazard_node;
 
@@ -59,11 +63,13 @@ typedef struct hazard_pointer_thread_record
 {
     struct hazard_pointer_thread_record* volatile * head;
     struct hazard_pointer_thread_record* next;
+    volatile int active;//0 once released; claimed again by CAS
+    hazard_node_t* volatile orphans;//retired nodes left behind by release
     size_t retire_threshold;
     size_t retired_count;
     hazard_node_t* retired_list;
     size_t plist_size;
-    hazard_node_t** plist;//a scratch area used in scan(); it's here to avoid malloc()ing in each scan()
+    hazard_node_t** plist;//a scratch hash set of hazard pointers used in scan(); it's here to avoid malloc()ing in each scan(). plist_size is a power of 2
     size_t hazard_pointers_count;
     hazard_node_t* hazard_pointers[];
 } hazard_pointer_thread_record_t;
@@ -72,11 +78,17 @@ typedef struct hazard_pointer_thread_record
 extern "C" {
 #endif
 
-//create a new record and fuse it into the list of records at 'head'
+//take over a released record in the list at 'head', or create a new record and fuse it into the list
 extern hazard_pointer_thread_record_t* hazard_pointer_thread_record_create_and_push(hazard_pointer_thread_record_t** head, size_t pointers_per_thread);
 
+//call this when the owning thread is done with hptr. its hazard pointers are cleared, and retired nodes which can't be freed yet are left as orphans.
+//hptr stays in the list and must not be used by the caller afterwards.
+extern void hazard_pointer_thread_record_release(hazard_pointer_thread_record_t* hptr);
+
 extern void hazard_pointer_thread_record_destroy_all(hazard_pointer_thread_record_t* head);
 
+//records are never unlinked from their list, so while hptr is reachable from *hptr->head this only releases it (see release()) and it stays in the list; destroy_all() frees it.
+//a record which has been unlinked from every list is scanned and freed; any node it retired must no longer be hazardous.
 extern void hazard_pointer_thread_record_destroy(hazard_pointer_thread_record_t* hptr);
 
 //call this when you first grab an unsafe pointer. make sure to check it's still the pointer you want.
@@ -84,7 +96,7 @@ static inline void hazard_pointer_using(hazard_pointer_thread_record_t* hptr, ha
 {
     assert(n < hptr->hazard_pointers_count);
     hptr->hazard_pointers[n] = node;
-    store_load_barrier();//make sure other processors can see we're using this pointer
+    asymmetric_barrier_light();//make sure scan() can see we're using this pointer; pairs with the heavy barrier in scan()
 }
 
 //call this when you're done with the pointer
@@ -1,6 +1,9 @@
 #ifndef _CONCURENT_MPECIFIC_H
 #define _CONCURENT_MPECIFIC_H
 
+#include <stdint.h>
+#include <time.h>
+
 #include "arch.h"
 
 typedef struct pointer_pair
@@ -27,8 +30,8 @@ static inline void store_load_barrier()
 #if defined(ARCH_x86)
     __asm__ __volatile__ ("lock; addl $0,0(%%esp)" : : : "memory");
 #elif defined(ARCH_x86_64)
-#else
     __asm__ __volatile__ ("lock; addq $0,0(%%rsp)" : : : "memory");
+#else
     #warn please define a store_load_barrier()
     __sync_synchronize();
 #endif
@@ -57,6 +60,21 @@ static inline void cpu_relax()
 #endif
 }
 
+/* a fast, monotonic (per cpu) counter. on x86 this is the TSC, which is
+   synchronized across cpus on machines with an invariant TSC */
+static inline uint64_t read_cycle_counter()
+{
+#if defined(ARCH_x86) || defined(ARCH_x86_64)
+    uint32_t low, high;
+    __asm__ __volatile__ ("rdtsc" : "=a" (low), "=d" (high));
+    return ((uint64_t)high << 32) | low;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+
 #if defined(ARCH_x86) || defined(ARCH_x86_64)
 #define FIBER_XCHG_POINTER
 static inline void* atomic_exchange_pointer(void** location, void* value)
@@ -30,6 +30,7 @@
 #include <malloc.h>
 #include <string.h>
 #include "hazard_pointer.h"
+#include "reclaim.h"
 #include <fibconcurrent/arch.h>
 
 #define MPMC_HAZARD_COUNT (2)
@@ -62,29 +63,31 @@ static inline int mpmc_fifo_init(mpmc_fifo_t* fifo, mpmc_fifo_node_t* initial_no
     return 1;
 }
 
-static inline void mpmc_fifo_destroy(hazard_pointer_thread_record_t* hptr, mpmc_fifo_t* fifo)
+//the reclaim variants take either a hazard pointer record (MPMC_HAZARD_COUNT pointers) or an EBR record; see reclaim.h
+static inline void mpmc_fifo_destroy_reclaim(reclaim_thread_t* r, mpmc_fifo_t* fifo)
 {
-    assert(hptr);
+    assert(r);
     if(fifo) {
         while(fifo->head != NULL) {
             mpmc_fifo_node_t* const tmp = fifo->head;
             fifo->head = tmp->prev;
-            hazard_pointer_free(hptr, &tmp->hazard);
+            reclaim_retire(r, &tmp->hazard);
         }
     }
 }
 
 //the FIFO owns new_node after pushing
-static inline void mpmc_fifo_push(hazard_pointer_thread_record_t* hptr, mpmc_fifo_t* fifo, mpmc_fifo_node_t* new_node)
+static inline void mpmc_fifo_push_reclaim(reclaim_thread_t* r, mpmc_fifo_t* fifo, mpmc_fifo_node_t* new_node)
 {
-    assert(hptr);
+    assert(r);
     assert(fifo);
     assert(new_node);
     assert(new_node->value);
     new_node->prev = NULL;
+    reclaim_enter(r);
     while(1) {
         mpmc_fifo_node_t* const tail = fifo->tail;
-        hazard_pointer_using(hptr, &tail->hazard, 0);
+        reclaim_protect(r, &tail->hazard, 0);
         if(tail != fifo->tail) {
             continue;//tail switched while we were 'using' it
         }
@@ -92,23 +95,25 @@ static inline void mpmc_fifo_push(hazard_pointer_thread_record_t* hptr, mpmc_fif
         new_node->next = tail;
         if(__sync_bool_compare_and_swap(&fifo->tail, tail, new_node)) {
             tail->prev = new_node;
-            hazard_pointer_done_using(hptr, 0);
-            return;
+            reclaim_unprotect(r, 0);
+            break;
         }
     }
+    reclaim_exit(r);
 }
 
-static inline void* mpmc_fifo_trypop(hazard_pointer_thread_record_t* hptr, mpmc_fifo_t* fifo)
+static inline void* mpmc_fifo_trypop_reclaim(reclaim_thread_t* r, mpmc_fifo_t* fifo)
 {
     void* ret = NULL;
 
-    assert(hptr);
+    assert(r);
     assert(fifo);
 
+    reclaim_enter(r);
     while(1) {
         mpmc_fifo_node_t* const head = fifo->head;
         mpmc_fifo_node_t* prev;
-        hazard_pointer_using(hptr, &head->hazard, 0);
+        reclaim_protect(r, &head->hazard, 0);
         if(head != fifo->head) {
             continue;//head switched while we were 'using' it
         }
@@ -116,11 +121,11 @@ static inline void* mpmc_fifo_trypop(hazard_pointer_thread_record_t* hptr, mpmc_
         prev = head->prev;
         if(!prev) {
             //empty (possibly just temporarily, let the caller decide what to do)
-            hazard_pointer_done_using(hptr, 0);
-            return NULL;
+            reclaim_unprotect(r, 0);
+            break;
         }
 
-        hazard_pointer_using(hptr, &prev->hazard, 1);
+        reclaim_protect(r, &prev->hazard, 1);
         if(head != fifo->head) {
             continue;//head switched while we were 'using' head->prev
         }
@@ -128,15 +133,35 @@ static inline void* mpmc_fifo_trypop(hazard_pointer_thread_record_t* hptr, mpmc_
         //push thread has successfully updated prev
         ret = prev->value;
         if(__sync_bool_compare_and_swap(&fifo->head, head, prev)) {
-            hazard_pointer_done_using(hptr, 0);
-            hazard_pointer_done_using(hptr, 1);
-            hazard_pointer_free(hptr, &head->hazard);
+            reclaim_unprotect(r, 0);
+            reclaim_unprotect(r, 1);
+            reclaim_retire(r, &head->hazard);
             break;
         }
     }
+    reclaim_exit(r);
     return ret;
 }
 
+static inline void mpmc_fifo_destroy(hazard_pointer_thread_record_t* hptr, mpmc_fifo_t* fifo)
+{
+    reclaim_thread_t r = reclaim_thread_hazard_pointer(hptr);
+    mpmc_fifo_destroy_reclaim(&r, fifo);
+}
+
+//the FIFO owns new_node after pushing
+static inline void mpmc_fifo_push(hazard_pointer_thread_record_t* hptr, mpmc_fifo_t* fifo, mpmc_fifo_node_t* new_node)
+{
+    reclaim_thread_t r = reclaim_thread_hazard_pointer(hptr);
+    mpmc_fifo_push_reclaim(&r, fifo, new_node);
+}
+
+static inline void* mpmc_fifo_trypop(hazard_pointer_thread_record_t* hptr, mpmc_fifo_t* fifo)
+{
+    reclaim_thread_t r = reclaim_thread_hazard_pointer(hptr);
+    return mpmc_fifo_trypop_reclaim(&r, fifo);
+}
+
 //TODO: size() (?) O(n), not good for much except testing
 //TODO: try_push()
 //TODO: fix_list() (?) allows a pop()er to help push()er threads along by possibly updating nodes' prev field
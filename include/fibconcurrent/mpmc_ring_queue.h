@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _MPMC_RING_QUEUE_H_
+#define _MPMC_RING_QUEUE_H_
+
+/*
+    Description: A bounded multi-producer multi-consumer queue based on
+                 Dmitry Vyukov's "Bounded MPMC queue". Each slot carries a
+                 sequence number which tells producers and consumers whether
+                 the slot is free for the current lap, so an enqueue or a
+                 dequeue costs a single CAS on put_pos or get_pos. Producers
+                 and consumers never write to the same index, and any value
+                 (including NULL) can be stored.
+
+    Properties: 1. Strict FIFO (per slot claim order)
+                2. Lock free
+                3. Bounded (capacity is a power of 2)
+*/
+
+#include <stddef.h>
+
+#include <fibconcurrent/queuedef.h>
+
+/* defined in src/mpmc_ring_queue_internal.h */
+typedef struct mpmc_q_s mpmc_ring_queue_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Create a queue with q_size slots. q_size must be a power of 2 greater than 1.
+ * Returns QERR_OK, QERR_BADSIZE or QERR_MALLOCERR. */
+qerr_t mpmc_ring_queue_create(mpmc_ring_queue_t** q, size_t q_size);
+
+/* Destroy the queue. If free_fn is not NULL, it's called for every message
+ * still in the queue. Must not be called while other threads use the queue. */
+void mpmc_ring_queue_destroy(mpmc_ring_queue_t* q, free_func free_fn);
+
+/* Returns QERR_OK if d was enqueued, QERR_FULL if no slot is available */
+qerr_t mpmc_ring_queue_enqueue(mpmc_ring_queue_t* q, void* d);
+
+/* Returns QERR_OK and stores the message in *d, QERR_EMPTY if no message is available */
+qerr_t mpmc_ring_queue_dequeue(mpmc_ring_queue_t* q, void** d);
+
+size_t mpmc_ring_queue_capacity(const mpmc_ring_queue_t* q);
+
+/* Approximate number of messages in the queue */
+size_t mpmc_ring_queue_len(const mpmc_ring_queue_t* q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MPMC_RING_QUEUE_H_ */
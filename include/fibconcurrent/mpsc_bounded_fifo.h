@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _MPSC_BOUNDED_FIFO_H_
+#define _MPSC_BOUNDED_FIFO_H_
+
+/*
+    Description: A multi-producer single-consumer FIFO (the mpsc_fifo
+                 algorithm) holding at most capacity items. Producers take a
+                 credit before pushing; the credits are split over
+                 num_shards counters on separate cache lines, and each
+                 producer (or group of producers) pushes with its own shard
+                 index, so producers don't contend on a single counter.
+
+                 The consumer keeps the credits of popped items in a private
+                 per-shard count and returns them to the shard with one
+                 atomic add per batch, or all at once when the FIFO runs
+                 empty (so a producer is never stuck waiting for a partial
+                 batch).
+
+    Properties: 1. Strict FIFO
+                2. Lock free try_push; push spins until a credit is available
+                3. Bounded (at most capacity items are queued at any time)
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <fibconcurrent/arch.h>
+#include <fibconcurrent/machine_specific.h>
+
+typedef struct mpsc_bounded_fifo_node
+{
+    void* data;
+    size_t shard;
+    struct mpsc_bounded_fifo_node* volatile next;
+} mpsc_bounded_fifo_node_t;
+
+typedef struct mpsc_bounded_fifo_credits
+{
+    volatile int64_t credits;
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(int64_t)];
+} mpsc_bounded_fifo_credits_t;
+
+typedef struct mpsc_bounded_fifo
+{
+    mpsc_bounded_fifo_node_t* volatile head;//consumer read items from head
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(mpsc_bounded_fifo_node_t*)];
+    mpsc_bounded_fifo_node_t* tail;//producer pushes onto the tail
+    char _cache_padding2[CACHE_LINE_SIZE - sizeof(mpsc_bounded_fifo_node_t*)];
+    mpsc_bounded_fifo_credits_t* shards;
+    int64_t* pending;//consumer only: credits not yet returned, per shard
+    size_t num_shards;
+    size_t capacity;
+    int64_t batch;
+} mpsc_bounded_fifo_t;
+
+static inline void mpsc_bounded_fifo_destroy(mpsc_bounded_fifo_t* f)
+{
+    if(f) {
+        while(f->head != NULL) {
+            mpsc_bounded_fifo_node_t* const tmp = f->head;
+            f->head = tmp->next;
+            free(tmp);
+        }
+        free(f->shards);
+        free(f->pending);
+        f->shards = NULL;
+        f->pending = NULL;
+    }
+}
+
+//capacity is split evenly over num_shards; each shard gets at least one credit. credits are returned to a shard batch at a time
+static inline int mpsc_bounded_fifo_init(mpsc_bounded_fifo_t* f, size_t capacity, size_t num_shards, size_t batch)
+{
+    void* shards = NULL;
+    size_t i;
+    assert(f);
+    assert(num_shards);
+    assert(capacity >= num_shards);
+    memset(f, 0, sizeof(*f));
+    f->num_shards = num_shards;
+    f->capacity = capacity;
+    //a shard must be able to fill a batch on its own
+    f->batch = batch && batch <= capacity / num_shards ? (int64_t)batch : (int64_t)(capacity / num_shards);
+    f->tail = (mpsc_bounded_fifo_node_t*)calloc(1, sizeof(*f->tail));
+    f->head = f->tail;
+    f->pending = (int64_t*)calloc(num_shards, sizeof(*f->pending));
+    if(!posix_memalign(&shards, CACHE_LINE_SIZE, num_shards * sizeof(mpsc_bounded_fifo_credits_t))) {
+        f->shards = (mpsc_bounded_fifo_credits_t*)shards;
+    }
+    if(!f->tail || !f->pending || !f->shards) {
+        mpsc_bounded_fifo_destroy(f);
+        return 0;
+    }
+    for(i = 0; i < num_shards; ++i) {
+        f->shards[i].credits = (int64_t)(capacity / num_shards + (i < capacity % num_shards ? 1 : 0));
+    }
+    return 1;
+}
+
+static inline size_t mpsc_bounded_fifo_capacity(const mpsc_bounded_fifo_t* f)
+{
+    assert(f);
+    return f->capacity;
+}
+
+//returns 1 if a credit was taken from the shard, 0 if the shard has none left
+static inline int mpsc_bounded_fifo_acquire_credit(mpsc_bounded_fifo_t* f, size_t shard)
+{
+    mpsc_bounded_fifo_credits_t* const credits = &f->shards[shard];
+    if(__atomic_load_n(&credits->credits, __ATOMIC_RELAXED) <= 0) {
+        return 0;
+    }
+    if(__atomic_fetch_sub(&credits->credits, 1, __ATOMIC_ACQUIRE) <= 0) {
+        //lost the race for the last credit
+        __atomic_fetch_add(&credits->credits, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    return 1;
+}
+
+static inline void mpsc_bounded_fifo_enqueue(mpsc_bounded_fifo_t* f, size_t shard, mpsc_bounded_fifo_node_t* new_node)
+{
+    mpsc_bounded_fifo_node_t* prev_tail;
+    new_node->shard = shard;
+    new_node->next = NULL;
+    prev_tail = (mpsc_bounded_fifo_node_t*) __atomic_exchange_n((void**)&f->tail, new_node, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev_tail->next, new_node, __ATOMIC_RELEASE);
+}
+
+//returns 1 if the node was pushed (the FIFO owns it afterwards), 0 if the shard is out of credits.
+//producers should use a stable shard index, ie. one per thread or group of threads
+static inline int mpsc_bounded_fifo_try_push(mpsc_bounded_fifo_t* f, size_t shard, mpsc_bounded_fifo_node_t* new_node)
+{
+    assert(f);
+    assert(new_node);
+    shard %= f->num_shards;
+    if(!mpsc_bounded_fifo_acquire_credit(f, shard)) {
+        return 0;
+    }
+    mpsc_bounded_fifo_enqueue(f, shard, new_node);
+    return 1;
+}
+
+//waits for a credit
+static inline void mpsc_bounded_fifo_push(mpsc_bounded_fifo_t* f, size_t shard, mpsc_bounded_fifo_node_t* new_node)
+{
+    assert(f);
+    assert(new_node);
+    shard %= f->num_shards;
+    while(!mpsc_bounded_fifo_acquire_credit(f, shard)) {
+        cpu_relax();
+    }
+    mpsc_bounded_fifo_enqueue(f, shard, new_node);
+}
+
+//consumer only. return all pending credits to the producers
+static inline void mpsc_bounded_fifo_flush_credits(mpsc_bounded_fifo_t* f)
+{
+    size_t i;
+    assert(f);
+    for(i = 0; i < f->num_shards; ++i) {
+        if(f->pending[i]) {
+            __atomic_fetch_add(&f->shards[i].credits, f->pending[i], __ATOMIC_RELEASE);
+            f->pending[i] = 0;
+        }
+    }
+}
+
+//the caller owns the node after popping. returns NULL if the FIFO is empty
+static inline mpsc_bounded_fifo_node_t* mpsc_bounded_fifo_trypop(mpsc_bounded_fifo_t* f)
+{
+    mpsc_bounded_fifo_node_t* prev_head;
+    mpsc_bounded_fifo_node_t* prev_next;
+    size_t shard;
+    assert(f);
+    prev_head = f->head;
+    prev_next = __atomic_load_n(&prev_head->next, __ATOMIC_ACQUIRE);
+    if(!prev_next) {
+        mpsc_bounded_fifo_flush_credits(f);
+        return NULL;
+    }
+    f->head = prev_next;
+    prev_head->data = prev_next->data;
+    prev_head->shard = shard = prev_next->shard;
+    if(++f->pending[shard] >= f->batch) {
+        __atomic_fetch_add(&f->shards[shard].credits, f->pending[shard], __ATOMIC_RELEASE);
+        f->pending[shard] = 0;
+    }
+    return prev_head;
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _MPSC_EVENT_FIFO_H_
+#define _MPSC_EVENT_FIFO_H_
+
+/*
+    Description: An mpsc_fifo with a file descriptor which becomes readable
+                 when the FIFO goes from empty to non-empty, for consumers
+                 running an epoll/poll event loop. The descriptor is an
+                 eventfd (a pipe where eventfd is not available).
+
+                 Producers write to the descriptor only if the signaled flag
+                 is clear, so a burst of pushes costs one system call. The
+                 consumer calls mpsc_event_fifo_rearm() when the descriptor
+                 is readable, then drains with mpsc_event_fifo_trypop() until
+                 it returns NULL. No wakeup is lost: rearm clears the flag
+                 before the drain looks at tail, and a producer swaps tail
+                 before it looks at the flag (both sequentially consistent),
+                 so either the producer signals again or the drain sees the
+                 new tail and waits for the node to be linked.
+
+    Properties: 1. Strict FIFO
+                2. Lock free push; one syscall per empty to non-empty transition
+*/
+
+#include <fibconcurrent/mpsc_fifo.h>
+#include <fibconcurrent/machine_specific.h>
+
+typedef struct mpsc_event_fifo
+{
+    mpsc_fifo_t fifo;
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(mpsc_fifo_t) % CACHE_LINE_SIZE];
+    volatile int signaled;//set by the producer which writes to the descriptor
+    char _cache_padding2[CACHE_LINE_SIZE - sizeof(int)];
+    int fd;//the readable side
+    int write_fd;//same as fd for an eventfd
+} mpsc_event_fifo_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int mpsc_event_fifo_init(mpsc_event_fifo_t* f);
+
+extern void mpsc_event_fifo_destroy(mpsc_event_fifo_t* f);
+
+//make the descriptor readable
+extern void mpsc_event_fifo_signal(mpsc_event_fifo_t* f);
+
+//consumer only. consume the readiness of the descriptor and clear the signaled flag. drain the FIFO afterwards.
+extern void mpsc_event_fifo_rearm(mpsc_event_fifo_t* f);
+
+#ifdef __cplusplus
+}
+#endif
+
+//the descriptor to register with epoll/poll for reading
+static inline int mpsc_event_fifo_fd(const mpsc_event_fifo_t* f)
+{
+    assert(f);
+    return f->fd;
+}
+
+//the FIFO owns new_node after pushing
+static inline void mpsc_event_fifo_push(mpsc_event_fifo_t* f, mpsc_fifo_node_t* new_node)
+{
+    mpsc_fifo_node_t* prev_tail;
+    assert(f);
+    assert(new_node);
+    new_node->next = NULL;
+    prev_tail = (mpsc_fifo_node_t*) __atomic_exchange_n((void**)&f->fifo.tail, new_node, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&prev_tail->next, new_node, __ATOMIC_RELEASE);
+    if(!__atomic_load_n(&f->signaled, __ATOMIC_SEQ_CST)
+       && !__atomic_exchange_n(&f->signaled, 1, __ATOMIC_SEQ_CST)) {
+        mpsc_event_fifo_signal(f);
+    }
+}
+
+//consumer only. the caller owns the node after popping. returns NULL if the FIFO is empty
+static inline mpsc_fifo_node_t* mpsc_event_fifo_trypop(mpsc_event_fifo_t* f)
+{
+    mpsc_fifo_node_t* node;
+    assert(f);
+    while(!(node = mpsc_fifo_trypop(&f->fifo))) {
+        if(__atomic_load_n(&f->fifo.tail, __ATOMIC_SEQ_CST) == f->fifo.head) {
+            return NULL;
+        }
+        cpu_relax();//another thread has pushed, but hasn't finished linking its node
+    }
+    return node;
+}
+
+#endif
@@ -76,6 +76,20 @@ static inline void mpsc_fifo_push(mpsc_fifo_t* f, mpsc_fifo_node_t* new_node)
     prev_tail->next = new_node;
 }
 
+//push a chain of nodes linked through next, from first to last, with a single exchange.
+//the FIFO owns the nodes after pushing
+static inline void mpsc_fifo_push_chain(mpsc_fifo_t* f, mpsc_fifo_node_t* first, mpsc_fifo_node_t* last)
+{
+    mpsc_fifo_node_t* prev_tail;
+    assert(f);
+    assert(first);
+    assert(last);
+    last->next = NULL;
+    prev_tail = (mpsc_fifo_node_t*) __atomic_exchange_n((void**)&f->tail, last, __ATOMIC_ACQ_REL);
+    //the links inside the chain become visible to the consumer with this store
+    __atomic_store_n(&prev_tail->next, first, __ATOMIC_RELEASE);
+}
+
 //returns 1 if a node is available, 0 otherwise
 static inline int mpsc_fifo_peek(mpsc_fifo_t* f, void** data)
 {
@@ -109,4 +123,24 @@ static inline mpsc_fifo_node_t* mpsc_fifo_trypop(mpsc_fifo_t* f)
     return NULL;
 }
 
+//pop up to max nodes into out, walking the list once and updating head once.
+//returns the number of nodes popped; the caller owns them
+static inline size_t mpsc_fifo_pop_many(mpsc_fifo_t* f, mpsc_fifo_node_t** out, size_t max)
+{
+    mpsc_fifo_node_t* head;
+    mpsc_fifo_node_t* next;
+    size_t count = 0;
+    assert(f);
+    assert(out);
+    head = f->head;
+    while(count < max && (next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE))) {
+        //as in trypop, the old head node carries the data out
+        head->data = next->data;
+        out[count++] = head;
+        head = next;
+    }
+    f->head = head;
+    return count;
+}
+
 #endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _MPSC_INTRUSIVE_FIFO_H_
+#define _MPSC_INTRUSIVE_FIFO_H_
+
+/*
+    Description: An intrusive multi-producer single-consumer FIFO based on
+                 Dmitry Vyukov's "Intrusive MPSC node-based queue". The node
+                 is embedded in the caller's object (see
+                 mpsc_intrusive_fifo_entry()) and trypop returns the node
+                 which was pushed, not a stub carrying a copy of its data.
+                 The FIFO embeds its own stub node, which the consumer
+                 re-pushes when it pops the last node.
+
+                 trypop tells an empty FIFO (MPSC_INTRUSIVE_EMPTY) apart from
+                 a producer which swapped tail but hasn't linked its node yet
+                 (MPSC_INTRUSIVE_RETRY); in the latter case the node will be
+                 available shortly. Also usable as an SPSC FIFO.
+
+    Properties: 1. Strict FIFO
+                2. Wait free push (a single exchange)
+                3. No allocation
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include <fibconcurrent/arch.h>
+
+typedef struct mpsc_intrusive_node
+{
+    struct mpsc_intrusive_node* volatile next;
+} mpsc_intrusive_node_t;
+
+typedef struct mpsc_intrusive_fifo
+{
+    mpsc_intrusive_node_t* volatile tail;//producers push onto the tail
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(mpsc_intrusive_node_t*)];
+    mpsc_intrusive_node_t* head;//consumer reads items from head
+    mpsc_intrusive_node_t stub;
+} mpsc_intrusive_fifo_t;
+
+#define MPSC_INTRUSIVE_EMPTY ((mpsc_intrusive_node_t*)(0))
+#define MPSC_INTRUSIVE_RETRY ((mpsc_intrusive_node_t*)(-1))
+
+//get the object containing node, given the member name of the embedded mpsc_intrusive_node_t
+#define mpsc_intrusive_fifo_entry(node, type, member) \
+    ((type*)((char*)(node) - offsetof(type, member)))
+
+static inline void mpsc_intrusive_fifo_init(mpsc_intrusive_fifo_t* f)
+{
+    assert(f);
+    f->stub.next = NULL;
+    f->head = &f->stub;
+    f->tail = &f->stub;
+}
+
+//the FIFO uses node until it's popped
+static inline void mpsc_intrusive_fifo_push(mpsc_intrusive_fifo_t* f, mpsc_intrusive_node_t* node)
+{
+    mpsc_intrusive_node_t* prev_tail;
+    assert(f);
+    assert(node);
+    node->next = NULL;
+    prev_tail = (mpsc_intrusive_node_t*)__atomic_exchange_n((void**)&f->tail, node, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev_tail->next, node, __ATOMIC_RELEASE);
+}
+
+//consumer only. returns the node which was pushed, MPSC_INTRUSIVE_EMPTY or MPSC_INTRUSIVE_RETRY
+static inline mpsc_intrusive_node_t* mpsc_intrusive_fifo_trypop(mpsc_intrusive_fifo_t* f)
+{
+    mpsc_intrusive_node_t* head;
+    mpsc_intrusive_node_t* next;
+    assert(f);
+    head = f->head;
+    next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    if(head == &f->stub) {
+        if(!next) {
+            return __atomic_load_n(&f->tail, __ATOMIC_ACQUIRE) == head ? MPSC_INTRUSIVE_EMPTY : MPSC_INTRUSIVE_RETRY;
+        }
+        //skip the stub
+        f->head = head = next;
+        next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    }
+    if(next) {
+        f->head = next;
+        return head;
+    }
+    if(__atomic_load_n(&f->tail, __ATOMIC_ACQUIRE) != head) {
+        //a producer is between its exchange and linking to head
+        return MPSC_INTRUSIVE_RETRY;
+    }
+    //head is the last node; push the stub behind it so head can be returned
+    mpsc_intrusive_fifo_push(f, &f->stub);
+    next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    if(next) {
+        f->head = next;
+        return head;
+    }
+    return MPSC_INTRUSIVE_RETRY;
+}
+
+#endif
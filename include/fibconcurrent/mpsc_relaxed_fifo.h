@@ -31,56 +31,195 @@
                  NOTE: this MPSC FIFO provides *per-producer* FIFO and makes a 
                  best effort attempt to round-robin pops accross all producers.
 
+                 Summary bitmap: a producer sets its lane's bit after a push
+                 if the bit is clear, and the consumer clears it when it
+                 finds the lane empty (then looks once more, so a racing push
+                 is never missed). The consumer finds non-empty lanes with
+                 ctz over the bitmap words instead of touching each lane, so
+                 an empty poll costs a load per 64 lanes. The push and the
+                 producer's read of the bit are ordered with
+                 asymmetric_barrier_light(), paired with
+                 asymmetric_barrier_heavy() in the consumer's
+                 clear-then-recheck, which runs once each time a lane goes
+                 empty. After asymmetric_barrier_init() a push costs no
+                 fence (see asymmetric_barrier.h). Without it, a push
+                 costs a full fence.
+
+                 Dynamic mode (MPSCR_FIFO_DYNAMIC): the FIFO is created with
+                 num_producers lanes which producers claim at runtime with
+                 mpscr_fifo_register() and give back with
+                 mpscr_fifo_deregister(). The lane number is the producer
+                 number to push with (keep it in thread-local storage).
+                 Deregistering sets the lane's bit, so the consumer visits
+                 the lane once more, drains it and recycles it for the next
+                 registration.
+
+                 mpscr_fifo_drain() pops a batch with deficit round robin:
+                 each visit to a lane adds the lane's quantum (weight) to its
+                 deficit and pops up to that many items, so a batch stays on
+                 one lane while its cache lines are hot and heavier lanes get
+                 a proportionally larger share.
+
+                 Ordered mode (MPSCR_FIFO_ORDERED): producers push
+                 mpscr_fifo_ordered_node_t nodes with
+                 mpscr_fifo_push_ordered(), which records
+                 read_cycle_counter() in the node. The consumer pops the
+                 oldest item over the heads of all non-empty lanes, so items
+                 come out in (approximately, within the skew of the cpus'
+                 counters) global push order, without any shared write on
+                 the producer side. A pop costs a look at every non-empty
+                 lane.
+
     Properties: 1. Per-producer FIFO, best effort FIFO accross producers
-                2. Wait free
+                2. Wait free (registration is lock free)
 */
 
 #include "spsc_fifo.h"
+#include "asymmetric_barrier.h"
+
+#define MPSCR_FIFO_DYNAMIC (1)
+#define MPSCR_FIFO_ORDERED (2)
+
+#define MPSCR_FIFO_LANE_FREE (0)
+#define MPSCR_FIFO_LANE_ACTIVE (1)
+#define MPSCR_FIFO_LANE_RETIRED (2)//deregistered, but may still hold items
+
+#define MPSCR_FIFO_NO_LANE ((size_t)-1)
+
+#define MPSCR_FIFO_WORD_BITS (64)
+
+typedef struct mpscr_fifo_ordered_node
+{
+    spsc_node_t node;//must be first
+    uint64_t timestamp;
+} mpscr_fifo_ordered_node_t;
+
+typedef struct mpscr_fifo_lane
+{
+    spsc_fifo_t fifo;
+    volatile int state;
+    char _cache_padding1[CACHE_LINE_SIZE - (sizeof(spsc_fifo_t) + sizeof(int)) % CACHE_LINE_SIZE];
+} mpscr_fifo_lane_t;
 
 typedef struct mpscr_fifo
 {
-    size_t counter; //this increments on each read. (counter % num_producers)
-                    //indicates which producer will be popped from next
-    char _cache_padding1[CACHE_LINE_SIZE - sizeof(size_t)];
+    size_t counter; //the lane the consumer's next scan starts from
+    size_t* deficit;//mpscr_fifo_drain(): per lane items left from the lane's quantum; follows the summary
+    int drain_resume;//mpscr_fifo_drain(): the last drain stopped within the quantum of lane counter
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(size_t) - sizeof(size_t*) - sizeof(int)];
     size_t num_producers;
-    char _cache_padding2[CACHE_LINE_SIZE - sizeof(size_t)];
-    spsc_fifo_t fifos[];
+    int flags;
+    volatile uint64_t* summary;//bit i is set when lane i may hold items; follows the lanes
+    size_t summary_words;
+    char _cache_padding2[CACHE_LINE_SIZE - 2 * sizeof(size_t) - sizeof(int) - sizeof(uint64_t*)];
+    mpscr_fifo_lane_t lanes[];
 } mpscr_fifo_t;
 
-static inline mpscr_fifo_t* mpscr_fifo_create(size_t num_producers)
+static inline void mpscr_fifo_destroy(mpscr_fifo_t* f)
 {
-    size_t i;
+    if(f) {
+        size_t i;
+        for(i = 0; i < f->num_producers; ++i) {
+            spsc_fifo_t* const the_fifo = &f->lanes[i].fifo;
+            spsc_fifo_destroy(the_fifo);
+        }
+        free(f);
+    }
+}
+
+//flags is 0, MPSCR_FIFO_DYNAMIC and/or MPSCR_FIFO_ORDERED. in dynamic mode num_producers is the maximum number of registered producers
+static inline mpscr_fifo_t* mpscr_fifo_create_ex(size_t num_producers, int flags)
+{
+    size_t i, summary_words, summary_size;
     mpscr_fifo_t* ret;
+    void* mem = NULL;
     assert(num_producers > 0);
-    ret = malloc(sizeof(*ret) + num_producers * sizeof(spsc_fifo_t));
-    if(!ret) {
+    summary_words = (num_producers + MPSCR_FIFO_WORD_BITS - 1) / MPSCR_FIFO_WORD_BITS;
+    summary_size = (summary_words * sizeof(uint64_t) + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+    if(posix_memalign(&mem, CACHE_LINE_SIZE, sizeof(*ret) + num_producers * sizeof(mpscr_fifo_lane_t) + summary_size
+                      + num_producers * sizeof(size_t))) {
         return NULL;
     }
+    ret = (mpscr_fifo_t*)mem;
     ret->counter = 0;
     ret->num_producers = num_producers;
+    ret->flags = flags;
+    ret->summary = (volatile uint64_t*)&ret->lanes[num_producers];
+    ret->summary_words = summary_words;
+    memset((void*)ret->summary, 0, summary_size);
+    ret->deficit = (size_t*)((char*)ret->summary + summary_size);
+    memset(ret->deficit, 0, num_producers * sizeof(size_t));
+    ret->drain_resume = 0;
     for(i = 0; i < num_producers; ++i) {
-        if(!spsc_fifo_init(&ret->fifos[i])) {
-            size_t j = 0;
-            for(j = 0; j < i; ++j) {
-                spsc_fifo_destroy(&ret->fifos[j]);
+        if(flags & MPSCR_FIFO_ORDERED) {
+            //the stub is returned by a pop like any other node, so it must be an ordered node too
+            mpscr_fifo_ordered_node_t* const stub = (mpscr_fifo_ordered_node_t*)calloc(1, sizeof(*stub));
+            if(!stub) {
+                ret->num_producers = i;
+                mpscr_fifo_destroy(ret);
+                return NULL;
             }
-            free(ret);
+            spsc_fifo_init_node(&ret->lanes[i].fifo, &stub->node);
+        } else if(!spsc_fifo_init(&ret->lanes[i].fifo)) {
+            ret->num_producers = i;
+            mpscr_fifo_destroy(ret);
             return NULL;
         }
+        ret->lanes[i].state = (flags & MPSCR_FIFO_DYNAMIC) ? MPSCR_FIFO_LANE_FREE : MPSCR_FIFO_LANE_ACTIVE;
     }
     return ret;
 }
 
-static inline void mpscr_fifo_destroy(mpscr_fifo_t* f)
+static inline mpscr_fifo_t* mpscr_fifo_create(size_t num_producers)
 {
-    if(f) {
-        size_t i;
-        for(i = 0; i < f->num_producers; ++i) {
-            spsc_fifo_t* const the_fifo = &f->fifos[i];
-            spsc_fifo_destroy(the_fifo);
+    return mpscr_fifo_create_ex(num_producers, 0);
+}
+
+//1 if lane's bit is set, ie. it may hold items
+static inline int mpscr_fifo_summary_test(mpscr_fifo_t* f, size_t lane)
+{
+    const uint64_t bit = (uint64_t)1 << (lane % MPSCR_FIFO_WORD_BITS);
+    return (__atomic_load_n(&f->summary[lane / MPSCR_FIFO_WORD_BITS], __ATOMIC_RELAXED) & bit) != 0;
+}
+
+static inline void mpscr_fifo_summary_set(mpscr_fifo_t* f, size_t lane)
+{
+    const uint64_t bit = (uint64_t)1 << (lane % MPSCR_FIFO_WORD_BITS);
+    volatile uint64_t* const word = &f->summary[lane / MPSCR_FIFO_WORD_BITS];
+    //order the push (or retirement) before reading the bit; pairs with the heavy barrier in the consumer's clear-then-check
+    asymmetric_barrier_light();
+    //usually the bit is set already and the word stays shared
+    if(!(__atomic_load_n(word, __ATOMIC_RELAXED) & bit)) {
+        __atomic_fetch_or(word, bit, __ATOMIC_SEQ_CST);
+    }
+}
+
+//dynamic mode. returns the lane (producer number) for the calling producer or MPSCR_FIFO_NO_LANE if all lanes are in use
+static inline size_t mpscr_fifo_register(mpscr_fifo_t* f)
+{
+    size_t i;
+    assert(f);
+    assert(f->flags & MPSCR_FIFO_DYNAMIC);
+    for(i = 0; i < f->num_producers; ++i) {
+        int expected = MPSCR_FIFO_LANE_FREE;
+        if(f->lanes[i].state == MPSCR_FIFO_LANE_FREE
+           && __atomic_compare_exchange_n(&f->lanes[i].state, &expected, MPSCR_FIFO_LANE_ACTIVE, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return i;
         }
-        free(f);
     }
+    return MPSCR_FIFO_NO_LANE;
+}
+
+//dynamic mode. the producer must not push to lane afterwards; its items are still delivered
+static inline void mpscr_fifo_deregister(mpscr_fifo_t* f, size_t lane)
+{
+    assert(f);
+    assert(f->flags & MPSCR_FIFO_DYNAMIC);
+    assert(lane < f->num_producers);
+    assert(f->lanes[lane].state == MPSCR_FIFO_LANE_ACTIVE);
+    __atomic_store_n(&f->lanes[lane].state, MPSCR_FIFO_LANE_RETIRED, __ATOMIC_RELEASE);
+    //make the consumer visit the lane so it gets recycled
+    mpscr_fifo_summary_set(f, lane);
 }
 
 //the FIFO owns new_node after pushing
@@ -93,28 +232,194 @@ static inline void mpscr_fifo_push(mpscr_fifo_t* f, size_t producer_number, spsc
     assert(producer_number < f->num_producers);
     assert(new_node);
     index = producer_number % f->num_producers;
-    fifo = &f->fifos[index];
+    fifo = &f->lanes[index].fifo;
     spsc_fifo_push(fifo, new_node);
+    mpscr_fifo_summary_set(f, index);
+}
+
+//ordered mode. the FIFO owns new_node after pushing
+static inline void mpscr_fifo_push_ordered(mpscr_fifo_t* f, size_t producer_number, mpscr_fifo_ordered_node_t* new_node)
+{
+    assert(f);
+    assert(f->flags & MPSCR_FIFO_ORDERED);
+    assert(new_node);
+    new_node->timestamp = read_cycle_counter();
+    mpscr_fifo_push(f, producer_number, &new_node->node);
+}
+
+//consumer only. returns the first lane at or after lane (wrapping) which has its bit set and is
+//less than remaining lanes away, or MPSCR_FIFO_NO_LANE
+static inline size_t mpscr_fifo_next_lane(mpscr_fifo_t* f, size_t lane, size_t remaining)
+{
+    const size_t num_producers = f->num_producers;
+    while(remaining) {
+        const size_t bit = lane % MPSCR_FIFO_WORD_BITS;
+        //the bits past num_producers are never set
+        const uint64_t bits = __atomic_load_n(&f->summary[lane / MPSCR_FIFO_WORD_BITS], __ATOMIC_ACQUIRE) >> bit;
+        size_t skip;
+        if(bits) {
+            skip = (size_t)__builtin_ctzll(bits);
+            if(skip < remaining && lane + skip < num_producers) {
+                return lane + skip;
+            }
+        }
+        skip = MPSCR_FIFO_WORD_BITS - bit;
+        if(skip > num_producers - lane) {
+            skip = num_producers - lane;
+        }
+        if(skip >= remaining) {
+            break;
+        }
+        remaining -= skip;
+        lane += skip;
+        if(lane == num_producers) {
+            lane = 0;
+        }
+    }
+    return MPSCR_FIFO_NO_LANE;
+}
+
+//consumer only. the lane looked empty: clear its bit and check again. returns 1 if the lane is empty
+static inline int mpscr_fifo_lane_empty(mpscr_fifo_t* f, size_t index)
+{
+    mpscr_fifo_lane_t* const lane = &f->lanes[index];
+    const uint64_t bit = (uint64_t)1 << (index % MPSCR_FIFO_WORD_BITS);
+    int state;
+    __atomic_fetch_and(&f->summary[index / MPSCR_FIFO_WORD_BITS], ~bit, __ATOMIC_SEQ_CST);
+    //order the clear before looking at the lane; pairs with the producer's light barrier
+    asymmetric_barrier_heavy();
+    state = __atomic_load_n(&lane->state, __ATOMIC_ACQUIRE);
+    if(spsc_fifo_peek(&lane->fifo)) {
+        //the producer may have seen the bit still set; keep it set until the lane is empty
+        __atomic_fetch_or(&f->summary[index / MPSCR_FIFO_WORD_BITS], bit, __ATOMIC_RELAXED);
+        return 0;
+    }
+    if(state == MPSCR_FIFO_LANE_RETIRED) {
+        //every push happened before the producer retired the lane
+        __atomic_store_n(&lane->state, MPSCR_FIFO_LANE_FREE, __ATOMIC_RELEASE);
+    }
+    return 1;
+}
+
+//consumer only. ordered mode: pop from the lane whose next item is the oldest
+static inline mpscr_fifo_ordered_node_t* mpscr_fifo_trypop_ordered(mpscr_fifo_t* f)
+{
+    const size_t num_producers = f->num_producers;
+    size_t lane = 0;
+    size_t oldest_lane = MPSCR_FIFO_NO_LANE;
+    uint64_t oldest = 0;
+    mpscr_fifo_ordered_node_t* out;
+    assert(f->flags & MPSCR_FIFO_ORDERED);
+    while((lane = mpscr_fifo_next_lane(f, lane, num_producers - lane)) != MPSCR_FIFO_NO_LANE) {
+        const mpscr_fifo_ordered_node_t* next = (const mpscr_fifo_ordered_node_t*)spsc_fifo_peek(&f->lanes[lane].fifo);
+        if(next || !mpscr_fifo_lane_empty(f, lane)) {
+            next = (const mpscr_fifo_ordered_node_t*)spsc_fifo_peek(&f->lanes[lane].fifo);
+            if(oldest_lane == MPSCR_FIFO_NO_LANE || (int64_t)(next->timestamp - oldest) < 0) {
+                oldest_lane = lane;
+                oldest = next->timestamp;
+            }
+        }
+        if(++lane == num_producers) {
+            break;
+        }
+    }
+    if(oldest_lane == MPSCR_FIFO_NO_LANE) {
+        return NULL;
+    }
+    out = (mpscr_fifo_ordered_node_t*)spsc_fifo_trypop(&f->lanes[oldest_lane].fifo);
+    out->timestamp = oldest;
+    return out;
 }
 
 //the caller owns the node after popping
 static inline spsc_node_t* mpscr_fifo_trypop(mpscr_fifo_t* f)
 {
     const size_t num_producers = f->num_producers;
-    size_t i;
-    for(i = 0; i < num_producers; ++i) {
-        spsc_fifo_t* fifo;
-        spsc_node_t* out;
-        const size_t index = f->counter % num_producers;
-        ++f->counter;
-        fifo = &f->fifos[index];
-        out = spsc_fifo_trypop(fifo);
+    size_t lane = f->counter;
+    size_t remaining = num_producers;
+    if(f->flags & MPSCR_FIFO_ORDERED) {
+        return (spsc_node_t*)mpscr_fifo_trypop_ordered(f);
+    }
+    while((lane = mpscr_fifo_next_lane(f, lane, remaining)) != MPSCR_FIFO_NO_LANE) {
+        spsc_node_t* out = spsc_fifo_trypop(&f->lanes[lane].fifo);
+        if(!out && !mpscr_fifo_lane_empty(f, lane)) {
+            out = spsc_fifo_trypop(&f->lanes[lane].fifo);
+        }
+        //the lanes from counter up to and including this one are visited
+        remaining = num_producers - (lane >= f->counter ? lane - f->counter : lane + num_producers - f->counter) - 1;
+        lane = lane + 1 == num_producers ? 0 : lane + 1;
         if(out) {
+            f->counter = lane;
             return out;
         }
+        if(!remaining) {
+            break;
+        }
     }
     return NULL;
 }
 
-#endif
+//consumer only. pops up to max items into out with deficit round robin over the non-empty lanes.
+//weights[i] is the quantum of lane i (items per visit, at least 1), or NULL for a quantum of 1 for
+//every lane. returns the number of items popped; the caller owns the nodes
+static inline size_t mpscr_fifo_drain(mpscr_fifo_t* f, spsc_node_t** out, size_t max, const size_t* weights)
+{
+    const size_t num_producers = f->num_producers;
+    size_t count = 0;
+    assert(f);
+    assert(out);
+    if(f->flags & MPSCR_FIFO_ORDERED) {
+        //ordered pops can't be batched per lane
+        spsc_node_t* node;
+        while(count < max && (node = mpscr_fifo_trypop(f))) {
+            out[count++] = node;
+        }
+        return count;
+    }
+    while(count < max) {
+        const size_t start = f->counter;
+        size_t lane = start;
+        size_t remaining = num_producers;
+        const size_t pass_start_count = count;
+        while(count < max && (lane = mpscr_fifo_next_lane(f, lane, remaining)) != MPSCR_FIFO_NO_LANE) {
+            spsc_fifo_t* const fifo = &f->lanes[lane].fifo;
+            size_t deficit = f->deficit[lane];
+            if(!(f->drain_resume && lane == start)) {
+                deficit += weights && weights[lane] ? weights[lane] : 1;
+            }
+            f->drain_resume = 0;
+            while(deficit && count < max) {
+                spsc_node_t* node = spsc_fifo_trypop(fifo);
+                if(!node && !mpscr_fifo_lane_empty(f, lane)) {
+                    node = spsc_fifo_trypop(fifo);
+                }
+                if(!node) {
+                    //an empty lane doesn't keep its deficit
+                    deficit = 0;
+                    break;
+                }
+                out[count++] = node;
+                --deficit;
+            }
+            f->deficit[lane] = deficit;
+            if(deficit) {
+                //out is full; continue with this lane's quantum on the next drain
+                f->counter = lane;
+                f->drain_resume = 1;
+                return count;
+            }
+            remaining = num_producers - (lane >= start ? lane - start : lane + num_producers - start) - 1;
+            lane = lane + 1 == num_producers ? 0 : lane + 1;
+            f->counter = lane;
+            if(!remaining) {
+                break;
+            }
+        }
+        if(count == pass_start_count) {
+            break;
+        }
+    }
+    return count;
+}
 
+#endif
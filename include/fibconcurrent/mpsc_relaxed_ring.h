@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _MPSC_RELAXED_RING_H_
+#define _MPSC_RELAXED_RING_H_
+
+/*
+    Description: A bounded variant of mpscr_fifo whose per-producer lanes are
+                 spsc_ring_buffers instead of linked spsc_fifos, so a push
+                 doesn't need a node and a pop doesn't chase a pointer. All
+                 lanes live in one cache line aligned allocation, one after
+                 the other, so draining many lanes streams through memory.
+
+                 When a lane is full the overflow policy applies:
+                 MPSCR_RING_FAIL - push returns 0
+                 MPSCR_RING_SPIN - push waits for the consumer to make room
+                 MPSCR_RING_SPILL - the item goes to an unbounded linked
+                 spsc_fifo. Once a lane spilled, its producer keeps spilling
+                 until the consumer drained the spill list, and the consumer
+                 pops the ring before the spill list, so the lane stays FIFO.
+
+    Properties: 1. Per-producer FIFO, best effort FIFO accross producers
+                2. Wait free (except MPSCR_RING_SPIN pushes to a full lane)
+                3. Bounded lanes (a power of 2), unless spilling
+*/
+
+#include "spsc_fifo.h"
+#include "spsc_ring_buffer.h"
+
+#define MPSCR_RING_FAIL (0)
+#define MPSCR_RING_SPIN (1)
+#define MPSCR_RING_SPILL (2)
+
+typedef struct mpscr_ring_lane
+{
+    spsc_fifo_t spill;//MPSCR_RING_SPILL only
+    volatile uint64_t spilled;//written by the producer: items pushed to spill
+    char _cache_padding1[CACHE_LINE_SIZE - (sizeof(spsc_fifo_t) + sizeof(uint64_t)) % CACHE_LINE_SIZE];
+    volatile uint64_t unspilled;//written by the consumer: items popped from spill
+    char _cache_padding2[CACHE_LINE_SIZE - sizeof(uint64_t)];
+    //the lane's spsc_ring_buffer_t follows
+} mpscr_ring_lane_t;
+
+typedef struct mpscr_ring
+{
+    size_t counter; //this increments on each read. (counter % num_producers)
+                    //indicates which producer will be popped from next
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(size_t)];
+    size_t num_producers;
+    size_t lane_size;//bytes from one lane to the next
+    int policy;
+    char _cache_padding2[CACHE_LINE_SIZE - 2 * sizeof(size_t) - sizeof(int)];
+    //lanes must be last - they spill outside of this struct
+    char lanes[];
+} mpscr_ring_t;
+
+static inline mpscr_ring_lane_t* mpscr_ring_lane(mpscr_ring_t* r, size_t index)
+{
+    return (mpscr_ring_lane_t*)(r->lanes + index * r->lane_size);
+}
+
+static inline spsc_ring_buffer_t* mpscr_ring_lane_buffer(mpscr_ring_lane_t* lane)
+{
+    return (spsc_ring_buffer_t*)(lane + 1);
+}
+
+static inline void mpscr_ring_destroy(mpscr_ring_t* r)
+{
+    if(r) {
+        if(r->policy == MPSCR_RING_SPILL) {
+            size_t i;
+            for(i = 0; i < r->num_producers; ++i) {
+                spsc_fifo_destroy(&mpscr_ring_lane(r, i)->spill);
+            }
+        }
+        free(r);
+    }
+}
+
+//each of the num_producers lanes holds 2^power_of_2_size items
+static inline mpscr_ring_t* mpscr_ring_create(size_t num_producers, uint32_t power_of_2_size, int policy)
+{
+    size_t i, lane_size;
+    mpscr_ring_t* ret;
+    void* mem = NULL;
+    assert(num_producers > 0);
+    assert(policy == MPSCR_RING_FAIL || policy == MPSCR_RING_SPIN || policy == MPSCR_RING_SPILL);
+    lane_size = sizeof(mpscr_ring_lane_t) + spsc_ring_buffer_required_size(power_of_2_size);
+    lane_size = (lane_size + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+    if(posix_memalign(&mem, CACHE_LINE_SIZE, sizeof(*ret) + num_producers * lane_size)) {
+        return NULL;
+    }
+    ret = (mpscr_ring_t*)mem;
+    ret->counter = 0;
+    ret->num_producers = num_producers;
+    ret->lane_size = lane_size;
+    ret->policy = policy;
+    for(i = 0; i < num_producers; ++i) {
+        mpscr_ring_lane_t* const lane = mpscr_ring_lane(ret, i);
+        memset(lane, 0, sizeof(*lane));
+        spsc_ring_buffer_init(mpscr_ring_lane_buffer(lane), power_of_2_size);
+        if(policy == MPSCR_RING_SPILL && !spsc_fifo_init(&lane->spill)) {
+            ret->num_producers = i;
+            mpscr_ring_destroy(ret);
+            return NULL;
+        }
+    }
+    return ret;
+}
+
+//returns 1 if data was pushed, 0 if the lane is full (MPSCR_RING_FAIL) or a spill node could not be allocated
+static inline int mpscr_ring_push(mpscr_ring_t* r, size_t producer_number, void* data)
+{
+    mpscr_ring_lane_t* lane;
+    spsc_ring_buffer_t* rb;
+    spsc_node_t* node;
+
+    assert(r);
+    assert(producer_number < r->num_producers);
+    lane = mpscr_ring_lane(r, producer_number);
+    rb = mpscr_ring_lane_buffer(lane);
+    switch(r->policy) {
+    case MPSCR_RING_FAIL:
+        return spsc_ring_buffer_trypush(rb, data);
+    case MPSCR_RING_SPIN:
+        while(!spsc_ring_buffer_trypush(rb, data)) {
+            cpu_relax();
+        }
+        return 1;
+    default:
+        //stay on the spill list until the consumer drained it
+        if(lane->spilled == __atomic_load_n(&lane->unspilled, __ATOMIC_ACQUIRE)
+           && spsc_ring_buffer_trypush(rb, data)) {
+            return 1;
+        }
+        node = (spsc_node_t*)malloc(sizeof(spsc_node_t));
+        if(!node) {
+            return 0;
+        }
+        node->data = data;
+        spsc_fifo_push(&lane->spill, node);
+        __atomic_store_n(&lane->spilled, lane->spilled + 1, __ATOMIC_RELEASE);
+        return 1;
+    }
+}
+
+//consumer only. returns 1 and stores the item in *out, 0 if every lane is empty
+static inline int mpscr_ring_trypop(mpscr_ring_t* r, void** out)
+{
+    const size_t num_producers = r->num_producers;
+    size_t i;
+    assert(out);
+    for(i = 0; i < num_producers; ++i) {
+        mpscr_ring_lane_t* lane;
+        const size_t index = r->counter % num_producers;
+        ++r->counter;
+        lane = mpscr_ring_lane(r, index);
+        if(spsc_ring_buffer_trypop(mpscr_ring_lane_buffer(lane), out)) {
+            return 1;
+        }
+        if(r->policy == MPSCR_RING_SPILL
+           && __atomic_load_n(&lane->spilled, __ATOMIC_ACQUIRE) != lane->unspilled) {
+            spsc_node_t* node;
+            //the producer spilled because the ring was full; those ring items come first
+            if(spsc_ring_buffer_trypop(mpscr_ring_lane_buffer(lane), out)) {
+                return 1;
+            }
+            node = spsc_fifo_trypop(&lane->spill);
+            assert(node);
+            *out = node->data;
+            free(node);
+            __atomic_store_n(&lane->unspilled, lane->unspilled + 1, __ATOMIC_RELEASE);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#endif
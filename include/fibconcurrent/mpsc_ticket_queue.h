@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _MPSC_TICKET_QUEUE_H_
+#define _MPSC_TICKET_QUEUE_H_
+
+/*
+    Description: A bounded multi-producer single-consumer queue where
+                 producers claim a slot with a single fetch-and-add on a
+                 ticket counter, which never fails or retries (unlike the
+                 CAS/exchange loops of lockfree_ring_buffer and mpsc_fifo).
+                 Each slot carries a sequence number: ticket t may write slot
+                 t % size once the sequence is t, and publishes its item by
+                 setting it to t + 1. The consumer reads slots in ticket
+                 order and frees each one for the next lap (t + size).
+
+                 A producer which holds a ticket for a slot the consumer
+                 hasn't freed yet waits for it. try_push() instead takes its
+                 ticket with a CAS, and only while the consumer's published
+                 position shows the slot is free, so it never waits. It
+                 retries if another producer takes the ticket first. pop_n() consumes a
+                 contiguous run of published slots and publishes the
+                 consumer's position once per run. Any value (including
+                 NULL) can be stored.
+
+    Properties: 1. Strict FIFO (ticket order)
+                2. Wait free claim (fetch-and-add); push waits while the queue is full
+                3. Bounded (size is a power of 2)
+*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "arch.h"
+#include "machine_specific.h"
+
+typedef struct mpsc_ticket_queue_slot
+{
+    volatile uint64_t seq;
+    void* data;
+} mpsc_ticket_queue_slot_t;
+
+typedef struct mpsc_ticket_queue
+{
+    //written by producers
+    volatile uint64_t ticket;
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(uint64_t)];
+    //written by the consumer
+    volatile uint64_t head;//published position, read by try_push()
+    uint64_t pos;//the consumer's position
+    char _cache_padding2[CACHE_LINE_SIZE - 2 * sizeof(uint64_t)];
+    uint64_t size;
+    uint64_t power_of_2_mod;
+    //slots must be last - it spills outside of this struct
+    mpsc_ticket_queue_slot_t slots[];
+} mpsc_ticket_queue_t;
+
+static inline size_t mpsc_ticket_queue_required_size(uint32_t power_of_2_size)
+{
+    assert(power_of_2_size && power_of_2_size < 32);
+    return sizeof(mpsc_ticket_queue_t) + ((size_t)1 << power_of_2_size) * sizeof(mpsc_ticket_queue_slot_t);
+}
+
+//q must point to at least mpsc_ticket_queue_required_size(power_of_2_size) bytes
+static inline void mpsc_ticket_queue_init(mpsc_ticket_queue_t* q, uint32_t power_of_2_size)
+{
+    uint64_t i;
+    assert(q);
+    assert(power_of_2_size && power_of_2_size < 32);
+    q->ticket = 0;
+    q->head = 0;
+    q->pos = 0;
+    q->size = (uint64_t)1 << power_of_2_size;
+    q->power_of_2_mod = q->size - 1;
+    //slot i is free for ticket i
+    for(i = 0; i < q->size; ++i) {
+        q->slots[i].seq = i;
+        q->slots[i].data = NULL;
+    }
+}
+
+static inline mpsc_ticket_queue_t* mpsc_ticket_queue_create(uint32_t power_of_2_size)
+{
+    void* ret = NULL;
+    if(posix_memalign(&ret, CACHE_LINE_SIZE, mpsc_ticket_queue_required_size(power_of_2_size))) {
+        return NULL;
+    }
+    mpsc_ticket_queue_init((mpsc_ticket_queue_t*)ret, power_of_2_size);
+    return (mpsc_ticket_queue_t*)ret;
+}
+
+static inline void mpsc_ticket_queue_destroy(mpsc_ticket_queue_t* q)
+{
+    free(q);
+}
+
+//approximate when called concurrently with push or pop
+static inline size_t mpsc_ticket_queue_size(const mpsc_ticket_queue_t* q)
+{
+    uint64_t head, ticket;
+    assert(q);
+    head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    ticket = __atomic_load_n(&q->ticket, __ATOMIC_ACQUIRE);
+    return ticket > head ? (size_t)(ticket - head) : 0;
+}
+
+static inline void mpsc_ticket_queue_write(mpsc_ticket_queue_t* q, uint64_t ticket, void* in)
+{
+    mpsc_ticket_queue_slot_t* const slot = &q->slots[ticket & q->power_of_2_mod];
+    //wait for the consumer to free the slot from the previous lap
+    while(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != ticket) {
+        cpu_relax();
+    }
+    slot->data = in;
+    __atomic_store_n(&slot->seq, ticket + 1, __ATOMIC_RELEASE);
+}
+
+//waits while the queue is full
+static inline void mpsc_ticket_queue_push(mpsc_ticket_queue_t* q, void* in)
+{
+    assert(q);
+    mpsc_ticket_queue_write(q, __atomic_fetch_add(&q->ticket, 1, __ATOMIC_RELAXED), in);
+}
+
+//returns 1 on success, 0 if the queue is full. never waits: a ticket is only taken (by CAS) while its slot is known to be free
+static inline int mpsc_ticket_queue_trypush(mpsc_ticket_queue_t* q, void* in)
+{
+    uint64_t ticket;
+    assert(q);
+    ticket = __atomic_load_n(&q->ticket, __ATOMIC_RELAXED);
+    do {
+        //head is published after the slots before it are freed, so slot ticket % size is free for ticket
+        if(ticket - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) >= q->size) {
+            return 0;
+        }
+    } while(!__atomic_compare_exchange_n(&q->ticket, &ticket, ticket + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    mpsc_ticket_queue_write(q, ticket, in);
+    return 1;
+}
+
+//consumer only! pops up to n items from contiguous published slots into out and publishes the new position once.
+//returns the number of items popped
+static inline size_t mpsc_ticket_queue_pop_n(mpsc_ticket_queue_t* q, void** out, size_t n)
+{
+    uint64_t pos;
+    size_t count = 0;
+    assert(q);
+    assert(out);
+    pos = q->pos;
+    while(count < n) {
+        mpsc_ticket_queue_slot_t* const slot = &q->slots[pos & q->power_of_2_mod];
+        if(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+            break;
+        }
+        out[count++] = slot->data;
+        //free the slot for the ticket of the next lap
+        __atomic_store_n(&slot->seq, pos + q->size, __ATOMIC_RELEASE);
+        ++pos;
+    }
+    if(count) {
+        q->pos = pos;
+        __atomic_store_n(&q->head, pos, __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+//consumer only! returns 1 on success, 0 if the next slot isn't published yet
+static inline int mpsc_ticket_queue_trypop(mpsc_ticket_queue_t* q, void** out)
+{
+    return mpsc_ticket_queue_pop_n(q, out, 1) == 1;
+}
+
+#endif
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _MPSC_UNROLLED_FIFO_H_
+#define _MPSC_UNROLLED_FIFO_H_
+
+/*
+    Description: An unbounded multi-producer single-consumer FIFO built from
+                 segments of UNROLLED_FIFO_SEGMENT_SIZE slots (an unrolled
+                 linked list). Producers claim a slot in the tail segment
+                 with a fetch-and-add on the segment's claim counter. The
+                 producer which claims the first index past the end links
+                 the next segment; the other producers which overflow wait
+                 for it. The consumer walks the slots sequentially and
+                 checks a per-slot ready flag. It can't tell an empty FIFO
+                 from a slot which a producer claimed but hasn't filled
+                 yet, so trypop returns 0 in both cases.
+
+                 Segments are type-stable: a producer may still hold a stale
+                 pointer to a drained segment, so drained segments are reused
+                 via a free list and only released on destroy. A segment's
+                 claim counter stays above UNROLLED_FIFO_SEGMENT_SIZE while
+                 it's drained or being linked, which turns a stale
+                 fetch-and-add into a harmless retry.
+
+    Properties: 1. Strict FIFO (slot claim order)
+                2. Lock free for producers (except when a segment has to be linked)
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "arch.h"
+#include "machine_specific.h"
+
+#ifndef UNROLLED_FIFO_SEGMENT_SIZE
+#define UNROLLED_FIFO_SEGMENT_SIZE (64)
+#endif
+
+typedef struct mpsc_unrolled_segment
+{
+    volatile size_t claim;//the next slot index to be claimed by a producer
+    struct mpsc_unrolled_segment* volatile next;
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(size_t) - sizeof(void*)];
+    void* slots[UNROLLED_FIFO_SEGMENT_SIZE];
+    volatile uint8_t ready[UNROLLED_FIFO_SEGMENT_SIZE];
+} mpsc_unrolled_segment_t;
+
+typedef struct mpsc_unrolled_fifo
+{
+    mpsc_unrolled_segment_t* head;//consumer reads items from head
+    size_t head_index;
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(mpsc_unrolled_segment_t*) - sizeof(size_t)];
+    mpsc_unrolled_segment_t* volatile tail;//producers push onto the tail
+    char _cache_padding2[CACHE_LINE_SIZE - sizeof(mpsc_unrolled_segment_t*)];
+    mpsc_unrolled_segment_t* volatile drained;//segments released by the consumer
+    mpsc_unrolled_segment_t* free_segments;//owned by the producer which links the next segment
+} mpsc_unrolled_fifo_t;
+
+static inline int mpsc_unrolled_fifo_init(mpsc_unrolled_fifo_t* f)
+{
+    mpsc_unrolled_segment_t* seg;
+    assert(f);
+    seg = (mpsc_unrolled_segment_t*)calloc(1, sizeof(*seg));
+    f->head = seg;
+    f->head_index = 0;
+    f->tail = seg;
+    f->drained = NULL;
+    f->free_segments = NULL;
+    if(!seg) {
+        return 0;
+    }
+    return 1;
+}
+
+static inline void mpsc_unrolled_segment_free_list(mpsc_unrolled_segment_t* seg)
+{
+    while(seg) {
+        mpsc_unrolled_segment_t* const next = seg->next;
+        free(seg);
+        seg = next;
+    }
+}
+
+static inline void mpsc_unrolled_fifo_destroy(mpsc_unrolled_fifo_t* f)
+{
+    if(f) {
+        mpsc_unrolled_segment_free_list(f->head);
+        mpsc_unrolled_segment_free_list(f->free_segments);
+        mpsc_unrolled_segment_free_list(f->drained);
+        f->head = NULL;
+        f->tail = NULL;
+        f->free_segments = NULL;
+        f->drained = NULL;
+    }
+}
+
+//called by the producer which claimed index UNROLLED_FIFO_SEGMENT_SIZE of tail
+static inline int mpsc_unrolled_fifo_link(mpsc_unrolled_fifo_t* f, mpsc_unrolled_segment_t* tail, void* data)
+{
+    mpsc_unrolled_segment_t* seg;
+    if(!f->free_segments) {
+        f->free_segments = (mpsc_unrolled_segment_t*)__atomic_exchange_n((void**)&f->drained, NULL, __ATOMIC_ACQUIRE);
+    }
+    seg = f->free_segments;
+    if(seg) {
+        //seg->claim is already past the end; the consumer cleared the ready flags
+        f->free_segments = seg->next;
+    } else {
+        seg = (mpsc_unrolled_segment_t*)calloc(1, sizeof(*seg));
+        if(!seg) {
+            //let the next producer try to link a segment
+            __atomic_store_n(&tail->claim, UNROLLED_FIFO_SEGMENT_SIZE, __ATOMIC_RELEASE);
+            return 0;
+        }
+        seg->claim = UNROLLED_FIFO_SEGMENT_SIZE + 1;
+    }
+    seg->slots[0] = data;
+    seg->ready[0] = 1;
+    seg->next = NULL;
+    __atomic_store_n(&tail->next, seg, __ATOMIC_RELEASE);
+    __atomic_store_n(&f->tail, seg, __ATOMIC_RELEASE);
+    //open the segment only now; stale claims on a reused segment have failed until here
+    __atomic_store_n(&seg->claim, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+//returns 0 if a new segment could not be allocated
+static inline int mpsc_unrolled_fifo_push(mpsc_unrolled_fifo_t* f, void* data)
+{
+    assert(f);
+    while(1) {
+        mpsc_unrolled_segment_t* const tail = __atomic_load_n(&f->tail, __ATOMIC_ACQUIRE);
+        const size_t index = __atomic_fetch_add(&tail->claim, 1, __ATOMIC_ACQUIRE);
+        if(index < UNROLLED_FIFO_SEGMENT_SIZE) {
+            tail->slots[index] = data;
+            __atomic_store_n(&tail->ready[index], 1, __ATOMIC_RELEASE);
+            return 1;
+        }
+        if(index == UNROLLED_FIFO_SEGMENT_SIZE) {
+            return mpsc_unrolled_fifo_link(f, tail, data);
+        }
+        //the segment is full (or tail is stale); wait for the next segment to be linked
+        while(__atomic_load_n(&f->tail, __ATOMIC_ACQUIRE) == tail
+              && __atomic_load_n(&tail->claim, __ATOMIC_RELAXED) > UNROLLED_FIFO_SEGMENT_SIZE) {
+            cpu_relax();
+        }
+    }
+}
+
+//consumer only. returns 1 and stores the item in *data if one is available, 0 otherwise
+static inline int mpsc_unrolled_fifo_trypop(mpsc_unrolled_fifo_t* f, void** data)
+{
+    mpsc_unrolled_segment_t* head;
+    size_t index;
+    assert(f);
+    assert(data);
+    head = f->head;
+    index = f->head_index;
+    if(index == UNROLLED_FIFO_SEGMENT_SIZE) {
+        mpsc_unrolled_segment_t* const next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+        mpsc_unrolled_segment_t* drained;
+        if(!next) {
+            return 0;
+        }
+        //every slot was filled and read, no producer writes to head anymore
+        drained = f->drained;
+        do {
+            head->next = drained;
+        } while(!__atomic_compare_exchange_n(&f->drained, &drained, head, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+        f->head = head = next;
+        f->head_index = index = 0;
+    }
+    if(!__atomic_load_n(&head->ready[index], __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    *data = head->slots[index];
+    head->ready[index] = 0;
+    f->head_index = index + 1;
+    return 1;
+}
+
+#endif
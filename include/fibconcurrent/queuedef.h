@@ -15,7 +15,9 @@ typedef unsigned int qerr_t;
 #define QERR_MALLOCERR 4 /* No memory available */
 #define QERR_FULL 5      /* No room in queue */
 #define QERR_EMPTY 6     /* No messages in queue */
-#define LAST_QERR 6      /* Set to value of last "QERR_*" definition */
+#define QERR_SYSERR 7    /* A system call failed, see errno */
+#define QERR_BADFORMAT 8 /* Shared queue header is invalid or incompatible */
+#define LAST_QERR 8      /* Set to value of last "QERR_*" definition */
 
 /* Validate queue size (used on create new queue) */
 qerr_t queue_size_is_valid(size_t q_size);
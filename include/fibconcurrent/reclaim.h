@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef _RECLAIM_H_
+#define _RECLAIM_H_
+
+/*
+    Description: A common interface over hazard pointers (hazard_pointer.h)
+                 and epoch based reclamation (ebr.h). This lets a
+                 structure be written once and the caller pick the scheme.
+                 A structure brackets each operation with reclaim_enter() and
+                 reclaim_exit(), calls reclaim_protect() for each shared
+                 node it dereferences (a hazard pointer publish, nothing for
+                 EBR) and reclaim_retire() for each node it unlinks.
+
+                 reclaim_thread_t is a small tagged handle and is cheap to
+                 build on the stack around an existing record.
+*/
+
+#include <fibconcurrent/hazard_pointer.h>
+#include <fibconcurrent/ebr.h>
+
+#define RECLAIM_HAZARD_POINTER (0)
+#define RECLAIM_EBR (1)
+
+typedef struct reclaim_thread
+{
+    int kind;
+    union
+    {
+        hazard_pointer_thread_record_t* hptr;
+        ebr_thread_record_t* ebr;
+    } record;
+} reclaim_thread_t;
+
+static inline reclaim_thread_t reclaim_thread_hazard_pointer(hazard_pointer_thread_record_t* hptr)
+{
+    reclaim_thread_t ret;
+    assert(hptr);
+    ret.kind = RECLAIM_HAZARD_POINTER;
+    ret.record.hptr = hptr;
+    return ret;
+}
+
+static inline reclaim_thread_t reclaim_thread_ebr(ebr_thread_record_t* rec)
+{
+    reclaim_thread_t ret;
+    assert(rec);
+    ret.kind = RECLAIM_EBR;
+    ret.record.ebr = rec;
+    return ret;
+}
+
+static inline void reclaim_enter(reclaim_thread_t* r)
+{
+    assert(r);
+    if(r->kind == RECLAIM_EBR) {
+        ebr_enter(r->record.ebr);
+    }
+}
+
+static inline void reclaim_exit(reclaim_thread_t* r)
+{
+    assert(r);
+    if(r->kind == RECLAIM_EBR) {
+        ebr_exit(r->record.ebr);
+    }
+}
+
+//with hazard pointers the caller must re-check node is still reachable afterwards
+static inline void reclaim_protect(reclaim_thread_t* r, hazard_node_t* node, size_t n)
+{
+    assert(r);
+    if(r->kind == RECLAIM_HAZARD_POINTER) {
+        hazard_pointer_using(r->record.hptr, node, n);
+    }
+}
+
+static inline void reclaim_unprotect(reclaim_thread_t* r, size_t n)
+{
+    assert(r);
+    if(r->kind == RECLAIM_HAZARD_POINTER) {
+        hazard_pointer_done_using(r->record.hptr, n);
+    }
+}
+
+static inline void reclaim_retire(reclaim_thread_t* r, hazard_node_t* node)
+{
+    assert(r);
+    if(r->kind == RECLAIM_EBR) {
+        ebr_retire(r->record.ebr, node);
+    } else {
+        hazard_pointer_free(r->record.hptr, node);
+    }
+}
+
+#endif
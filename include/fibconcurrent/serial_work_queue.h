@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef _SERIAL_WORK_QUEUE_H_
+#define _SERIAL_WORK_QUEUE_H_
+
+/*
+    Description: A work queue (see work_queue.h) where one thread at a time
+                 processes the pushed items. Unlike work_queue_t there are no
+                 in/out counters. Whether the queue is idle is kept in bit 0
+                 of the tail pointer of an intrusive Vyukov MPSC queue. A push
+                 is a single exchange. It both enqueues the item and tells
+                 the pusher whether it found the queue idle, which makes it
+                 the worker. A worker which finds the queue empty goes idle
+                 with a single CAS of the tail from the stub to the tagged
+                 stub. The CAS fails if anything was pushed in the meantime,
+                 and the worker then carries on.
+
+    Properties: 1. Strict FIFO
+                2. Wait free push (a single exchange)
+                3. No allocation; items are intrusive (see
+                   mpsc_intrusive_fifo_entry())
+*/
+
+#include <fibconcurrent/mpsc_intrusive_fifo.h>
+#include <fibconcurrent/work_queue.h>
+
+typedef struct serial_work_queue
+{
+    volatile uintptr_t tail;//producers push onto the tail. bit 0 is set while the queue is idle
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(uintptr_t)];
+    mpsc_intrusive_node_t* head;//the worker reads items from head
+    mpsc_intrusive_node_t stub;
+} serial_work_queue_t;
+
+#define SERIAL_WORK_QUEUE_IDLE ((uintptr_t)1)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void serial_work_queue_init(serial_work_queue_t* q);
+
+//the queue uses item until it's handed out by get_work()
+//WORK_QUEUE_START_WORKING is returned if the caller should begin working on the queued items. the caller should call get_work() until WORK_QUEUE_EMPTY is returned.
+//WORK_QUEUE_QUEUED is returned if the item is queued and will be processed by another thread.
+int serial_work_queue_push(serial_work_queue_t* q, mpsc_intrusive_node_t* item);
+
+//worker only. returns WORK_QUEUE_MORE_WORK with the next item in *out.
+//WORK_QUEUE_EMPTY is returned once the queue has gone idle, after which the caller is no longer the worker.
+int serial_work_queue_get_work(serial_work_queue_t* q, mpsc_intrusive_node_t** out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _SHM_RING_H_
+#define _SHM_RING_H_
+
+/*
+    Description: Bounded rings of fixed-size messages which can be shared
+                 between processes. The ring lives in a memfd (anonymous,
+                 shared by passing the fd) or in a named /dev/shm object, and
+                 holds no pointers: slots are addressed by index from an
+                 offset recorded in the header. The creator fills in a
+                 header (magic, version, mode, capacity, message size) and
+                 publishes the magic last; shm_ring_attach() and
+                 shm_ring_open() validate it and keep their own copy of the
+                 geometry, so a corrupted header can't make a process access
+                 memory outside the mapping.
+
+                 SHM_RING_SPSC: one producer and one consumer, each with a
+                 private cached copy of the other side's index.
+                 SHM_RING_MPSC: any number of producers claim slots with a
+                 CAS on tail; each slot carries a sequence number (Dmitry
+                 Vyukov's bounded queue) which tells the consumer when the
+                 message is written. One consumer.
+
+                 Messages are copied in and out; a message is at most
+                 msg_size bytes.
+
+    Properties: 1. Strict FIFO (claim order for MPSC)
+                2. Lock free; wait free for SPSC
+                3. Bounded (capacity is a power of 2)
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+
+#include <fibconcurrent/arch.h>
+#include <fibconcurrent/machine_specific.h>
+#include <fibconcurrent/queuedef.h>
+
+#define SHM_RING_MAGIC (0x676e6972u)//"ring"
+#define SHM_RING_VERSION (1)
+
+#define SHM_RING_SPSC (1)
+#define SHM_RING_MPSC (2)
+
+//the shared header, at offset 0 of the mapping
+typedef struct shm_ring_header
+{
+    volatile uint32_t magic;//stored last by the creator
+    uint32_t version;
+    uint32_t mode;
+    uint32_t msg_size;
+    uint64_t capacity;
+    uint64_t slot_size;
+    uint64_t slots_offset;
+    uint64_t map_size;
+    char _cache_padding1[CACHE_LINE_SIZE - 4 * sizeof(uint32_t) - 4 * sizeof(uint64_t)];
+    volatile uint64_t tail;//written by producers
+    char _cache_padding2[CACHE_LINE_SIZE - sizeof(uint64_t)];
+    volatile uint64_t head;//written by the consumer
+    char _cache_padding3[CACHE_LINE_SIZE - sizeof(uint64_t)];
+} shm_ring_header_t;
+
+typedef struct shm_ring_slot
+{
+    volatile uint64_t seq;//MPSC only
+    uint64_t len;
+    uint8_t payload[];
+} shm_ring_slot_t;
+
+//a process-local handle; each process (and each SPSC side) uses its own
+typedef struct shm_ring
+{
+    shm_ring_header_t* header;
+    uint8_t* slots;
+    uint64_t mask;
+    uint64_t slot_size;
+    uint64_t msg_size;
+    uint64_t head_cache;//SPSC producer's copy of head
+    uint64_t tail_cache;//SPSC consumer's copy of tail
+    uint32_t mode;
+    size_t map_size;
+    int fd;
+} shm_ring_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Create a ring of capacity slots (a power of 2 greater than 1) holding
+ * messages of up to msg_size bytes. If name is NULL the ring is backed by an
+ * anonymous memfd which other processes attach to via shm_ring_fd(),
+ * otherwise a new /dev/shm object called name is created (see shm_open()).
+ * Returns QERR_OK, QERR_BADSIZE, QERR_MALLOCERR or QERR_SYSERR. */
+extern qerr_t shm_ring_create(shm_ring_t** r, const char* name, uint32_t mode, size_t capacity, size_t msg_size);
+
+/* Map a ring created by another process. The fd is duplicated, the caller
+ * keeps ownership of fd. Returns QERR_OK, QERR_BADFORMAT, QERR_MALLOCERR or QERR_SYSERR. */
+extern qerr_t shm_ring_attach(shm_ring_t** r, int fd);
+
+/* Map a named ring created by another process */
+extern qerr_t shm_ring_open(shm_ring_t** r, const char* name);
+
+/* Unmap the ring and close the handle. The ring itself lives on until every
+ * process closed it (and, for named rings, shm_ring_unlink() was called). */
+extern void shm_ring_close(shm_ring_t* r);
+
+extern int shm_ring_unlink(const char* name);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline int shm_ring_fd(const shm_ring_t* r)
+{
+    assert(r);
+    return r->fd;
+}
+
+static inline size_t shm_ring_capacity(const shm_ring_t* r)
+{
+    assert(r);
+    return (size_t)(r->mask + 1);
+}
+
+static inline size_t shm_ring_msg_size(const shm_ring_t* r)
+{
+    assert(r);
+    return (size_t)r->msg_size;
+}
+
+static inline shm_ring_slot_t* shm_ring_slot(const shm_ring_t* r, uint64_t pos)
+{
+    return (shm_ring_slot_t*)(r->slots + (pos & r->mask) * r->slot_size);
+}
+
+static inline qerr_t shm_ring_spsc_trypush(shm_ring_t* r, const void* msg, size_t len)
+{
+    shm_ring_header_t* const header = r->header;
+    const uint64_t tail = header->tail;
+    shm_ring_slot_t* slot;
+    if(tail - r->head_cache > r->mask) {
+        r->head_cache = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+        if(tail - r->head_cache > r->mask) {
+            return QERR_FULL;
+        }
+    }
+    slot = shm_ring_slot(r, tail);
+    slot->len = len;
+    memcpy(slot->payload, msg, len);
+    __atomic_store_n(&header->tail, tail + 1, __ATOMIC_RELEASE);
+    return QERR_OK;
+}
+
+static inline qerr_t shm_ring_mpsc_trypush(shm_ring_t* r, const void* msg, size_t len)
+{
+    shm_ring_header_t* const header = r->header;
+    shm_ring_slot_t* slot;
+    uint64_t pos = __atomic_load_n(&header->tail, __ATOMIC_RELAXED);
+    while(1) {
+        int64_t dif;
+        slot = shm_ring_slot(r, pos);
+        dif = (int64_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+        if(dif == 0) {
+            if(__atomic_compare_exchange_n(&header->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if(dif < 0) {
+            //the slot still holds a message from the previous lap
+            return QERR_FULL;
+        } else {
+            pos = __atomic_load_n(&header->tail, __ATOMIC_RELAXED);
+        }
+    }
+    slot->len = len;
+    memcpy(slot->payload, msg, len);
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    return QERR_OK;
+}
+
+//returns QERR_OK, QERR_FULL or QERR_BADSIZE if len > msg_size
+static inline qerr_t shm_ring_trypush(shm_ring_t* r, const void* msg, size_t len)
+{
+    assert(r);
+    if(len > r->msg_size) {
+        return QERR_BADSIZE;
+    }
+    if(r->mode == SHM_RING_SPSC) {
+        return shm_ring_spsc_trypush(r, msg, len);
+    }
+    return shm_ring_mpsc_trypush(r, msg, len);
+}
+
+//consumer only. out must hold msg_size bytes. returns QERR_OK and stores the length in *len, or QERR_EMPTY
+static inline qerr_t shm_ring_trypop(shm_ring_t* r, void* out, size_t* len)
+{
+    shm_ring_header_t* header;
+    shm_ring_slot_t* slot;
+    uint64_t head, msg_len;
+    assert(r);
+    assert(out);
+    assert(len);
+    header = r->header;
+    head = header->head;
+    slot = shm_ring_slot(r, head);
+    if(r->mode == SHM_RING_SPSC) {
+        if(head == r->tail_cache) {
+            r->tail_cache = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+            if(head == r->tail_cache) {
+                return QERR_EMPTY;
+            }
+        }
+    } else if(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != head + 1) {
+        return QERR_EMPTY;
+    }
+    msg_len = slot->len;
+    //don't trust the other process with our buffer's size
+    if(msg_len > r->msg_size) {
+        msg_len = r->msg_size;
+    }
+    memcpy(out, slot->payload, msg_len);
+    *len = (size_t)msg_len;
+    if(r->mode == SHM_RING_MPSC) {
+        //free the slot for the producer of the next lap
+        __atomic_store_n(&slot->seq, head + r->mask + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&header->head, head + 1, __ATOMIC_RELEASE);
+    return QERR_OK;
+}
+
+#endif
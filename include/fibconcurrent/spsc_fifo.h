@@ -28,6 +28,13 @@
                  to the consumer via the pop method. This FIFO is wait-free.
                  NOTE: This SPSC FIFO provides strict FIFO ordering
 
+                 Node cache mode (spsc_fifo_init_cached()): based on Dmitry
+                 Vyukov's unbounded SPSC queue. Consumed nodes stay linked
+                 behind head and the producer reuses them for later pushes,
+                 so steady-state traffic does not allocate. The producer
+                 only reads head when its cached copy runs out of nodes.
+                 Use the *_cached() push/pop functions in this mode only.
+
     Properties: 1. Strict FIFO
                 2. Wait free
 */
@@ -51,6 +58,8 @@ typedef struct spsc_fifo
     spsc_node_t* head;//consumer read items from head
     char _cache_padding1[CACHE_LINE_SIZE - sizeof(spsc_node_t*)];
     spsc_node_t* tail;//producer pushes onto the tail
+    spsc_node_t* first;//node cache mode: the oldest consumed node, NULL otherwise
+    spsc_node_t* head_copy;//node cache mode: the producer's copy of head
 } spsc_fifo_t;
 
 static inline int spsc_fifo_init(spsc_fifo_t* f)
@@ -58,15 +67,43 @@ static inline int spsc_fifo_init(spsc_fifo_t* f)
     assert(f);
     f->tail = (spsc_node_t*)calloc(1, sizeof(*f->tail));
     f->head = f->tail;
+    f->first = NULL;
+    f->head_copy = NULL;
     if(!f->tail) {
         return 0;
     }
     return 1;
 }
 
+//use stub (allocated with malloc()) as the initial node, ie. if nodes are larger than spsc_node_t
+static inline void spsc_fifo_init_node(spsc_fifo_t* f, spsc_node_t* stub)
+{
+    assert(f);
+    assert(stub);
+    stub->next = NULL;
+    f->tail = stub;
+    f->head = stub;
+    f->first = NULL;
+    f->head_copy = NULL;
+}
+
+//node cache mode: nodes are owned by the FIFO and recycled by the producer
+static inline int spsc_fifo_init_cached(spsc_fifo_t* f)
+{
+    if(!spsc_fifo_init(f)) {
+        return 0;
+    }
+    f->first = f->head;
+    f->head_copy = f->head;
+    return 1;
+}
+
 static inline void spsc_fifo_destroy(spsc_fifo_t* f)
 {
     if(f) {
+        if(f->first) {
+            f->head = f->first;//the consumed nodes are still linked in node cache mode
+        }
         while(f->head != NULL) {
             spsc_node_t* const tmp = f->head;
             f->head = tmp->next;
@@ -88,6 +125,13 @@ static inline void spsc_fifo_push(spsc_fifo_t* f, spsc_node_t* new_node)
     prev_tail->next = new_node;
 }
 
+//consumer only. returns the node holding the next item (which stays in the FIFO), NULL if the FIFO is empty
+static inline spsc_node_t* spsc_fifo_peek(spsc_fifo_t* f)
+{
+    assert(f);
+    return f->head->next;
+}
+
 //the caller owns the node after popping
 static inline spsc_node_t* spsc_fifo_trypop(spsc_fifo_t* f)
 {
@@ -104,4 +148,52 @@ static inline spsc_node_t* spsc_fifo_trypop(spsc_fifo_t* f)
     return NULL;
 }
 
+//node cache mode, producer only. returns a consumed node or a newly allocated one
+static inline spsc_node_t* spsc_fifo_cached_node(spsc_fifo_t* f)
+{
+    spsc_node_t* node;
+    if(f->first == f->head_copy) {
+        f->head_copy = __atomic_load_n(&f->head, __ATOMIC_ACQUIRE);
+        if(f->first == f->head_copy) {
+            return (spsc_node_t*)malloc(sizeof(spsc_node_t));
+        }
+    }
+    node = f->first;
+    f->first = node->next;
+    return node;
+}
+
+//node cache mode. returns 0 if a node could not be allocated
+static inline int spsc_fifo_push_cached(spsc_fifo_t* f, void* data)
+{
+    spsc_node_t* node;
+    assert(f);
+    assert(f->first);
+    node = spsc_fifo_cached_node(f);
+    if(!node) {
+        return 0;
+    }
+    node->data = data;
+    spsc_fifo_push(f, node);
+    return 1;
+}
+
+//node cache mode. returns 1 and stores the data in *data if an item is available, 0 otherwise
+static inline int spsc_fifo_trypop_cached(spsc_fifo_t* f, void** data)
+{
+    spsc_node_t* head;
+    spsc_node_t* next;
+    assert(f);
+    assert(data);
+    head = f->head;
+    next = head->next;
+    if(next) {
+        *data = next->data;
+        //head is handed to the producer for reuse once head moves past it
+        __atomic_store_n(&f->head, next, __ATOMIC_RELEASE);
+        return 1;
+    }
+    return 0;
+}
+
 #endif
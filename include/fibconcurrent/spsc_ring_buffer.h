@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _SPSC_RING_BUFFER_H_
+#define _SPSC_RING_BUFFER_H_
+
+/*
+    Description: A bounded single-producer single-consumer ring buffer. The
+                 producer keeps a cached copy of the consumer's index and the
+                 consumer keeps a cached copy of the producer's index, so the
+                 other side's cache line is only read when the cached copy
+                 says the buffer is full (or empty). push_n()/pop_n() move a
+                 whole batch and publish it with a single store.
+                 Any value (including NULL) can be stored.
+
+    Properties: 1. Strict FIFO
+                2. Wait free
+                3. Bounded (size is a power of 2)
+*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arch.h"
+#include "machine_specific.h"
+
+typedef struct spsc_ring_buffer
+{
+    //written by the producer only
+    volatile uint64_t high;
+    uint64_t low_cache;//the producer's copy of low
+    char _cache_padding1[CACHE_LINE_SIZE - 2 * sizeof(uint64_t)];
+    //written by the consumer only
+    volatile uint64_t low;
+    uint64_t high_cache;//the consumer's copy of high
+    char _cache_padding2[CACHE_LINE_SIZE - 2 * sizeof(uint64_t)];
+    uint32_t size;
+    uint32_t power_of_2_mod;
+    //buffer must be last - it spills outside of this struct
+    void* buffer[];
+} spsc_ring_buffer_t;
+
+static inline size_t spsc_ring_buffer_required_size(uint32_t power_of_2_size)
+{
+    assert(power_of_2_size && power_of_2_size < 32);
+    return sizeof(spsc_ring_buffer_t) + ((size_t)1 << power_of_2_size) * sizeof(void*);
+}
+
+//rb must point to at least spsc_ring_buffer_required_size(power_of_2_size) bytes
+static inline void spsc_ring_buffer_init(spsc_ring_buffer_t* rb, uint32_t power_of_2_size)
+{
+    assert(rb);
+    assert(power_of_2_size && power_of_2_size < 32);
+    rb->high = 0;
+    rb->low_cache = 0;
+    rb->low = 0;
+    rb->high_cache = 0;
+    rb->size = (uint32_t)1 << power_of_2_size;
+    rb->power_of_2_mod = rb->size - 1;
+}
+
+static inline spsc_ring_buffer_t* spsc_ring_buffer_create(uint32_t power_of_2_size)
+{
+    void* ret = NULL;
+    if(posix_memalign(&ret, CACHE_LINE_SIZE, spsc_ring_buffer_required_size(power_of_2_size))) {
+        return NULL;
+    }
+    spsc_ring_buffer_init((spsc_ring_buffer_t*)ret, power_of_2_size);
+    return (spsc_ring_buffer_t*)ret;
+}
+
+static inline void spsc_ring_buffer_destroy(spsc_ring_buffer_t* rb)
+{
+    free(rb);
+}
+
+//approximate when called concurrently with push or pop
+static inline size_t spsc_ring_buffer_size(const spsc_ring_buffer_t* rb)
+{
+    uint64_t low, high;
+    assert(rb);
+    low = __atomic_load_n(&rb->low, __ATOMIC_ACQUIRE);
+    high = __atomic_load_n(&rb->high, __ATOMIC_ACQUIRE);
+    return high > low ? (size_t)(high - low) : 0;
+}
+
+//producer only! returns the number of free slots, reading low only if the cached copy shows less than wanted
+static inline uint64_t spsc_ring_buffer_free_slots(spsc_ring_buffer_t* rb, uint64_t high, uint64_t wanted)
+{
+    uint64_t free_slots = rb->size - (high - rb->low_cache);
+    if(free_slots < wanted) {
+        rb->low_cache = __atomic_load_n(&rb->low, __ATOMIC_ACQUIRE);
+        free_slots = rb->size - (high - rb->low_cache);
+    }
+    return free_slots;
+}
+
+//consumer only! returns the number of used slots, reading high only if the cached copy shows less than wanted
+static inline uint64_t spsc_ring_buffer_used_slots(spsc_ring_buffer_t* rb, uint64_t low, uint64_t wanted)
+{
+    uint64_t used_slots = rb->high_cache - low;
+    if(used_slots < wanted) {
+        rb->high_cache = __atomic_load_n(&rb->high, __ATOMIC_ACQUIRE);
+        used_slots = rb->high_cache - low;
+    }
+    return used_slots;
+}
+
+//producer only! returns 1 on success, 0 if the buffer is full
+static inline int spsc_ring_buffer_trypush(spsc_ring_buffer_t* rb, void* in)
+{
+    uint64_t high;
+    assert(rb);
+    high = rb->high;
+    if(!spsc_ring_buffer_free_slots(rb, high, 1)) {
+        return 0;
+    }
+    rb->buffer[high & rb->power_of_2_mod] = in;
+    __atomic_store_n(&rb->high, high + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+//producer only! pushes up to n items from in and publishes them at once. returns the number of items pushed
+static inline size_t spsc_ring_buffer_push_n(spsc_ring_buffer_t* rb, void* const* in, size_t n)
+{
+    uint64_t high, free_slots;
+    size_t index, first;
+    assert(rb);
+    assert(in || !n);
+    high = rb->high;
+    free_slots = spsc_ring_buffer_free_slots(rb, high, n);
+    if(n > free_slots) {
+        n = (size_t)free_slots;
+    }
+    if(!n) {
+        return 0;
+    }
+    index = (size_t)(high & rb->power_of_2_mod);
+    first = rb->size - index;
+    if(first > n) {
+        first = n;
+    }
+    memcpy(&rb->buffer[index], in, first * sizeof(void*));
+    memcpy(&rb->buffer[0], in + first, (n - first) * sizeof(void*));
+    __atomic_store_n(&rb->high, high + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+//consumer only! returns 1 and stores the item in *out on success, 0 if the buffer is empty
+static inline int spsc_ring_buffer_trypop(spsc_ring_buffer_t* rb, void** out)
+{
+    uint64_t low;
+    assert(rb);
+    assert(out);
+    low = rb->low;
+    if(!spsc_ring_buffer_used_slots(rb, low, 1)) {
+        return 0;
+    }
+    *out = rb->buffer[low & rb->power_of_2_mod];
+    __atomic_store_n(&rb->low, low + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+//consumer only! pops up to n items into out and releases their slots at once. returns the number of items popped
+static inline size_t spsc_ring_buffer_pop_n(spsc_ring_buffer_t* rb, void** out, size_t n)
+{
+    uint64_t low, used_slots;
+    size_t index, first;
+    assert(rb);
+    assert(out || !n);
+    low = rb->low;
+    used_slots = spsc_ring_buffer_used_slots(rb, low, n);
+    if(n > used_slots) {
+        n = (size_t)used_slots;
+    }
+    if(!n) {
+        return 0;
+    }
+    index = (size_t)(low & rb->power_of_2_mod);
+    first = rb->size - index;
+    if(first > n) {
+        first = n;
+    }
+    memcpy(out, &rb->buffer[index], first * sizeof(void*));
+    memcpy(out + first, &rb->buffer[0], (n - first) * sizeof(void*));
+    __atomic_store_n(&rb->low, low + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+#endif
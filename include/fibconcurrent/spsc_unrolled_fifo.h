@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _SPSC_UNROLLED_FIFO_H_
+#define _SPSC_UNROLLED_FIFO_H_
+
+/*
+    Description: An unbounded single-producer single-consumer FIFO built from
+                 segments of UNROLLED_FIFO_SEGMENT_SIZE slots (an unrolled
+                 linked list). The producer fills the tail segment and links
+                 a new one only when it is full; the consumer walks the slots
+                 sequentially. Compared to spsc_fifo this needs one
+                 allocation and one pointer chase per segment instead of per
+                 item. Drained segments are handed back to the producer
+                 through a lock-free free list and are released on destroy.
+
+    Properties: 1. Strict FIFO
+                2. Wait free (except when a segment has to be allocated)
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "arch.h"
+#include "machine_specific.h"
+
+#ifndef UNROLLED_FIFO_SEGMENT_SIZE
+#define UNROLLED_FIFO_SEGMENT_SIZE (64)
+#endif
+
+typedef struct spsc_unrolled_segment
+{
+    volatile size_t count;//slots published by the producer
+    struct spsc_unrolled_segment* volatile next;
+    void* slots[UNROLLED_FIFO_SEGMENT_SIZE];
+} spsc_unrolled_segment_t;
+
+typedef struct spsc_unrolled_fifo
+{
+    spsc_unrolled_segment_t* head;//consumer reads items from head
+    size_t head_index;
+    size_t head_count;//the consumer's copy of head->count
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(spsc_unrolled_segment_t*) - 2 * sizeof(size_t)];
+    spsc_unrolled_segment_t* tail;//producer pushes onto the tail
+    spsc_unrolled_segment_t* free_segments;//producer-owned segments ready for reuse
+    char _cache_padding2[CACHE_LINE_SIZE - 2 * sizeof(spsc_unrolled_segment_t*)];
+    spsc_unrolled_segment_t* volatile drained;//segments released by the consumer
+} spsc_unrolled_fifo_t;
+
+static inline int spsc_unrolled_fifo_init(spsc_unrolled_fifo_t* f)
+{
+    assert(f);
+    f->tail = (spsc_unrolled_segment_t*)calloc(1, sizeof(*f->tail));
+    f->head = f->tail;
+    f->head_index = 0;
+    f->head_count = 0;
+    f->free_segments = NULL;
+    f->drained = NULL;
+    if(!f->tail) {
+        return 0;
+    }
+    return 1;
+}
+
+static inline void spsc_unrolled_segment_free_list(spsc_unrolled_segment_t* seg)
+{
+    while(seg) {
+        spsc_unrolled_segment_t* const next = seg->next;
+        free(seg);
+        seg = next;
+    }
+}
+
+static inline void spsc_unrolled_fifo_destroy(spsc_unrolled_fifo_t* f)
+{
+    if(f) {
+        spsc_unrolled_segment_free_list(f->head);
+        spsc_unrolled_segment_free_list(f->free_segments);
+        spsc_unrolled_segment_free_list(f->drained);
+        f->head = NULL;
+        f->tail = NULL;
+        f->free_segments = NULL;
+        f->drained = NULL;
+    }
+}
+
+//producer only. returns 0 if a new segment could not be allocated
+static inline int spsc_unrolled_fifo_push(spsc_unrolled_fifo_t* f, void* data)
+{
+    spsc_unrolled_segment_t* tail;
+    spsc_unrolled_segment_t* seg;
+    size_t index;
+    assert(f);
+    tail = f->tail;
+    index = tail->count;
+    if(index < UNROLLED_FIFO_SEGMENT_SIZE) {
+        tail->slots[index] = data;
+        __atomic_store_n(&tail->count, index + 1, __ATOMIC_RELEASE);
+        return 1;
+    }
+
+    if(!f->free_segments) {
+        f->free_segments = (spsc_unrolled_segment_t*)__atomic_exchange_n((void**)&f->drained, NULL, __ATOMIC_ACQUIRE);
+    }
+    seg = f->free_segments;
+    if(seg) {
+        f->free_segments = seg->next;
+    } else {
+        seg = (spsc_unrolled_segment_t*)malloc(sizeof(*seg));
+        if(!seg) {
+            return 0;
+        }
+    }
+    seg->slots[0] = data;
+    seg->count = 1;
+    seg->next = NULL;
+    __atomic_store_n(&tail->next, seg, __ATOMIC_RELEASE);
+    f->tail = seg;
+    return 1;
+}
+
+//consumer only. returns 1 and stores the item in *data if one is available, 0 otherwise
+static inline int spsc_unrolled_fifo_trypop(spsc_unrolled_fifo_t* f, void** data)
+{
+    spsc_unrolled_segment_t* head;
+    size_t index;
+    assert(f);
+    assert(data);
+    head = f->head;
+    index = f->head_index;
+    if(index == f->head_count) {
+        if(index == UNROLLED_FIFO_SEGMENT_SIZE) {
+            spsc_unrolled_segment_t* const next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+            spsc_unrolled_segment_t* drained;
+            if(!next) {
+                return 0;
+            }
+            //give the drained segment back to the producer
+            drained = f->drained;
+            do {
+                head->next = drained;
+            } while(!__atomic_compare_exchange_n(&f->drained, &drained, head, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+            f->head = head = next;
+            f->head_index = index = 0;
+        }
+        f->head_count = __atomic_load_n(&head->count, __ATOMIC_ACQUIRE);
+        if(index == f->head_count) {
+            return 0;
+        }
+    }
+    *data = head->slots[index];
+    f->head_index = index + 1;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _SPSC_WAIT_FIFO_H_
+#define _SPSC_WAIT_FIFO_H_
+
+/*
+    Description: A waitable spsc_fifo. The consumer spins for a bounded number
+                 of attempts, then sets the sleeping flag, issues a heavy
+                 asymmetric barrier, re-checks the FIFO and waits on a futex.
+                 The producer pushes, issues a light asymmetric barrier (a
+                 compiler barrier once asymmetric_barrier_init() has been
+                 called; see asymmetric_barrier.h) and only
+                 makes a system call when it sees the sleeping flag. While
+                 the consumer is awake, a push costs no syscall and no atomic
+                 instruction beyond spsc_fifo_push().
+
+    Properties: 1. Strict FIFO
+                2. Wait free push; pop blocks when the FIFO is empty
+*/
+
+#include <fibconcurrent/spsc_fifo.h>
+#include <fibconcurrent/asymmetric_barrier.h>
+
+#ifndef SPSC_WAIT_FIFO_SPIN_COUNT
+#define SPSC_WAIT_FIFO_SPIN_COUNT (1000)
+#endif
+
+typedef struct spsc_wait_fifo
+{
+    spsc_fifo_t fifo;
+    char _cache_padding1[CACHE_LINE_SIZE - sizeof(spsc_fifo_t) % CACHE_LINE_SIZE];
+    volatile int sleeping;//set by the consumer before it parks, cleared by the producer which wakes it
+    char _cache_padding2[CACHE_LINE_SIZE - sizeof(int)];
+} spsc_wait_fifo_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//park the consumer until the producer clears the sleeping flag
+extern void spsc_wait_fifo_wait(spsc_wait_fifo_t* f);
+
+//clear the sleeping flag and wake the consumer
+extern void spsc_wait_fifo_wake(spsc_wait_fifo_t* f);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline int spsc_wait_fifo_init(spsc_wait_fifo_t* f)
+{
+    assert(f);
+    f->sleeping = 0;
+    return spsc_fifo_init(&f->fifo);
+}
+
+static inline void spsc_wait_fifo_destroy(spsc_wait_fifo_t* f)
+{
+    if(f) {
+        spsc_fifo_destroy(&f->fifo);
+    }
+}
+
+static inline void spsc_wait_fifo_push(spsc_wait_fifo_t* f, spsc_node_t* new_node)
+{
+    assert(f);
+    spsc_fifo_push(&f->fifo, new_node);
+    //order the push before reading the sleeping flag; pairs with the consumer's heavy barrier
+    asymmetric_barrier_light();
+    if(f->sleeping) {
+        spsc_wait_fifo_wake(f);
+    }
+}
+
+static inline spsc_node_t* spsc_wait_fifo_trypop(spsc_wait_fifo_t* f)
+{
+    assert(f);
+    return spsc_fifo_trypop(&f->fifo);
+}
+
+//blocks until an item is available
+static inline spsc_node_t* spsc_wait_fifo_pop(spsc_wait_fifo_t* f)
+{
+    spsc_node_t* node;
+    int i;
+    assert(f);
+    for(i = 0; i < SPSC_WAIT_FIFO_SPIN_COUNT; ++i) {
+        if((node = spsc_fifo_trypop(&f->fifo))) {
+            return node;
+        }
+        cpu_relax();
+    }
+    while(1) {
+        f->sleeping = 1;
+        //order the flag before re-checking the FIFO; pairs with the producer's light barrier
+        asymmetric_barrier_heavy();
+        if((node = spsc_fifo_trypop(&f->fifo))) {
+            f->sleeping = 0;
+            return node;
+        }
+        spsc_wait_fifo_wait(f);
+        if((node = spsc_fifo_trypop(&f->fifo))) {
+            return node;
+        }
+    }
+}
+
+#endif
@@ -19,12 +19,30 @@
 
 #include "mpsc_fifo.h"
 
+struct work_queue;
+
+//called by a worker which has used up its budget. the executor must arrange for another thread to call get_work() until it stops returning WORK_QUEUE_MORE_WORK.
+typedef void (*work_queue_executor_t)(struct work_queue* wq, void* arg);
+
 typedef struct work_queue
 {
     mpsc_fifo_t fifo;
     volatile int64_t in_count;
     char _cache_padding1[CACHE_LINE_SIZE - sizeof(int64_t)];
+    //owned by the current worker
     volatile int64_t out_count;
+    uint64_t budget_used;
+    uint64_t budget_start;
+    char _cache_padding2[CACHE_LINE_SIZE - sizeof(int64_t) - 2 * sizeof(uint64_t)];
+    //written by the worker and by pushers accepting a handoff
+    volatile int offer;
+    const void* volatile offer_owner;//identifies the offering thread; it must not accept its own offer
+    char _cache_padding3[CACHE_LINE_SIZE - sizeof(int) - sizeof(void*)];
+    //configuration, set before the queue is used
+    uint64_t max_items;
+    uint64_t max_ns;
+    work_queue_executor_t executor;
+    void* executor_arg;
 } work_queue_t;
 
 typedef mpsc_fifo_node_t work_queue_item_t;
@@ -34,6 +52,19 @@ typedef mpsc_fifo_node_t work_queue_item_t;
 
 #define WORK_QUEUE_MORE_WORK (1)
 #define WORK_QUEUE_EMPTY (0)
+#define WORK_QUEUE_HANDOFF (2)
+
+#define WORK_QUEUE_OFFER_NONE (0)
+#define WORK_QUEUE_OFFER_OFFERED (1)
+#define WORK_QUEUE_OFFER_ACCEPTED (2)
+#define WORK_QUEUE_OFFER_RELEASED (3)
+
+//spin this many times waiting for a delegated request before yielding the cpu
+#ifndef WORK_QUEUE_EXECUTE_SPIN_COUNT
+#define WORK_QUEUE_EXECUTE_SPIN_COUNT 1000
+#endif
+
+typedef void (*work_queue_fn_t)(void* arg);
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,6 +74,15 @@ int work_queue_init(work_queue_t* wq);
 
 void work_queue_destroy(work_queue_t* wq);
 
+//limit how long a single thread stays the worker. zero means no limit.
+//once max_items items have been handed out, or max_ns nanoseconds have passed since the worker took its first item, the worker gives the queue away:
+// - to the executor, if one is set. the executor is called from get_work(), which then returns WORK_QUEUE_HANDOFF.
+// - otherwise to the next thread that pushes. the worker keeps working until a pusher accepts, and get_work() returns WORK_QUEUE_HANDOFF after acceptance. the accepting pusher waits for the worker to come back into get_work() before push() returns WORK_QUEUE_START_WORKING.
+//only one thread works on the queue at any time, so items are still processed one at a time in order.
+void work_queue_set_budget(work_queue_t* wq, uint64_t max_items, uint64_t max_ns);
+
+void work_queue_set_executor(work_queue_t* wq, work_queue_executor_t executor, void* arg);
+
 //the work queue owns item after pushing
 //WORK_QUEUE_START_WORKING is returned if the caller should begin working on the queued items. the caller should call get_work() until WORK_QUEUE_EMPTY is returned.
 //WORK_QUEUE_QUEUED is returned is the work item is queued and will be processed by another thread.
@@ -51,8 +91,32 @@ int work_queue_push(work_queue_t* wq, work_queue_item_t* item);
 //caller owns *out afterwards.
 //returns WORK_QUEUE_MORE_WORK until the work queue is empty.
 //WORK_QUEUE_EMPTY is returned when the queue is empty.
+//WORK_QUEUE_HANDOFF is returned when the budget is used up and another thread now owns the queue.
+//the caller stops being the worker when anything other than WORK_QUEUE_MORE_WORK is returned.
 int work_queue_get_work(work_queue_t* wq, work_queue_item_t** out);
 
+//push n items linked through next, starting at first, with one in_count update and one exchange.
+//the return value has the same meaning as work_queue_push(), including accepting a handoff
+int work_queue_push_batch(work_queue_t* wq, work_queue_item_t* first, size_t n);
+
+//pop up to max items into out. the caller owns the items afterwards.
+//returns the number of items popped. zero is returned once the queue is empty or has been handed off (see work_queue_set_budget()), at which point the caller is no longer the worker.
+size_t work_queue_get_work_batch(work_queue_t* wq, work_queue_item_t** out, size_t max);
+
+//run fn(arg) with mutual exclusion against every other fn executed on wq, in push order.
+//if the caller becomes the worker it runs its own request and any requests queued by other threads, otherwise the current worker runs it on the caller's behalf.
+//returns 1 after fn(arg) has completed; anything fn wrote is visible to the caller.
+//returns 0 without running fn if no request node could be allocated.
+//a queue used with execute() must only carry requests pushed by execute().
+//fn must not call execute() on the same queue: the inner call waits for its request, which only the current worker (the thread running fn) could run, so it deadlocks.
+int work_queue_execute(work_queue_t* wq, work_queue_fn_t fn, void* arg);
+
+//run queued execute() requests until the caller is no longer the worker. for use by an executor (see work_queue_set_executor()) on a queue which carries execute() requests.
+void work_queue_execute_drain(work_queue_t* wq);
+
+//free the calling thread's cache of request nodes. optional: the cache is also freed when the thread exits.
+void work_queue_execute_thread_cleanup();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/asymmetric_barrier.h>
+#include <assert.h>
+
+#if HAVE_MEMBARRIER
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+volatile int asymmetric_barrier_expedited = 0;
+
+#if HAVE_MEMBARRIER
+static int membarrier(int cmd, unsigned int flags)
+{
+    return syscall(__NR_membarrier, cmd, flags);
+}
+#endif
+
+int asymmetric_barrier_init()
+{
+#if HAVE_MEMBARRIER
+    if(!asymmetric_barrier_expedited) {
+        const int supported = membarrier(MEMBARRIER_CMD_QUERY, 0);
+        if(supported > 0
+           && (supported & MEMBARRIER_CMD_PRIVATE_EXPEDITED)
+           && membarrier(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0) {
+            __atomic_store_n(&asymmetric_barrier_expedited, 1, __ATOMIC_SEQ_CST);
+        }
+    }
+#endif
+    return asymmetric_barrier_expedited;
+}
+
+void asymmetric_barrier_heavy()
+{
+#if HAVE_MEMBARRIER
+    if(asymmetric_barrier_expedited) {
+        //a thread which saw asymmetric_barrier_expedited == 0 used a full fence in its light barrier
+        const int ret = membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+        assert(ret == 0);
+        (void)ret;
+        return;
+    }
+#endif
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <fibconcurrent/byte_ring_buffer.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static int byte_ring_buffer_open_fd()
+{
+#if HAVE_MEMFD_CREATE
+    return memfd_create("byte_ring_buffer", MFD_CLOEXEC);
+#else
+    static unsigned int counter = 0;
+    char name[64];
+    int fd;
+    snprintf(name, sizeof(name), "/byte_ring_buffer.%d.%u", (int)getpid(), __sync_add_and_fetch(&counter, 1));
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if(fd >= 0) {
+        shm_unlink(name);
+    }
+    return fd;
+#endif
+}
+
+byte_ring_buffer_t* byte_ring_buffer_create(size_t capacity)
+{
+    byte_ring_buffer_t* rb;
+    uint8_t* base;
+    void* ret = NULL;
+    size_t size = (size_t) sysconf(_SC_PAGESIZE);
+
+    //the rounded up size and the doubled mapping must both fit in a size_t
+    if(capacity > BYTE_RING_BUFFER_MAX_CAPACITY) {
+        return NULL;
+    }
+    while(size < capacity) {
+        size <<= 1;
+    }
+
+    if(posix_memalign(&ret, CACHE_LINE_SIZE, sizeof(byte_ring_buffer_t))) {
+        return NULL;
+    }
+    rb = (byte_ring_buffer_t*)ret;
+    memset(rb, 0, sizeof(*rb));
+
+    rb->fd = byte_ring_buffer_open_fd();
+    if(rb->fd < 0) {
+        free(rb);
+        return NULL;
+    }
+    if(ftruncate(rb->fd, (off_t)size)) {
+        goto err_fd;
+    }
+
+    //reserve 2 * size of address space, then map the same pages into both halves
+    base = (uint8_t*)mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED) {
+        goto err_fd;
+    }
+    if(mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, rb->fd, 0) == MAP_FAILED
+       || mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, rb->fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * size);
+        goto err_fd;
+    }
+
+    rb->base = base;
+    rb->capacity = size;
+    rb->mask = size - 1;
+    return rb;
+
+err_fd:
+    close(rb->fd);
+    free(rb);
+    return NULL;
+}
+
+void byte_ring_buffer_destroy(byte_ring_buffer_t* rb)
+{
+    if(rb) {
+        munmap(rb->base, 2 * rb->capacity);
+        close(rb->fd);
+        free(rb);
+    }
+}
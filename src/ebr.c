@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <fibconcurrent/ebr.h>
+#include <stdlib.h>
+
+void ebr_init(ebr_t* ebr)
+{
+    assert(ebr);
+    //epoch 0 is never used so an empty limbo list (limbo_epoch 0) never looks current
+    ebr->epoch = EBR_LIMBO_LISTS;
+    ebr->head = NULL;
+}
+
+ebr_thread_record_t* ebr_thread_record_create_and_push(ebr_t* ebr)
+{
+    ebr_thread_record_t* ret;
+    ebr_thread_record_t* cur_head;
+
+    assert(ebr);
+    ret = (ebr_thread_record_t*)calloc(1, sizeof(*ret));
+    if(!ret) {
+        return NULL;
+    }
+    ret->ebr = ebr;
+    do {
+        cur_head = ebr->head;
+        ret->next = cur_head;
+    } while(!__sync_bool_compare_and_swap(&ebr->head, cur_head, ret));
+    return ret;
+}
+
+void ebr_destroy(ebr_t* ebr)
+{
+    ebr_thread_record_t* cur;
+    assert(ebr);
+    cur = ebr->head;
+    while(cur) {
+        ebr_thread_record_t* const next = cur->next;
+        size_t i;
+        assert(!cur->nesting);
+        for(i = 0; i < EBR_LIMBO_LISTS; ++i) {
+            ebr_free_list(cur->limbo[i]);
+        }
+        free(cur);
+        cur = next;
+    }
+    ebr->head = NULL;
+}
+
+static int ebr_try_advance(ebr_t* ebr, uint64_t epoch)
+{
+    const ebr_thread_record_t* cur;
+    //any enter() which didn't see epoch has published its local_epoch by now
+    asymmetric_barrier_heavy();
+    for(cur = ebr->head; cur; cur = cur->next) {
+        const uint64_t local = __atomic_load_n(&cur->local_epoch, __ATOMIC_ACQUIRE);
+        if((local & EBR_ACTIVE) && (local >> 1) != epoch) {
+            return 0;
+        }
+    }
+    return __sync_bool_compare_and_swap(&ebr->epoch, epoch, epoch + 1);
+}
+
+int ebr_collect(ebr_thread_record_t* rec)
+{
+    uint64_t epoch;
+    int advanced;
+    size_t i;
+    assert(rec);
+    epoch = __atomic_load_n(&rec->ebr->epoch, __ATOMIC_SEQ_CST);
+    advanced = ebr_try_advance(rec->ebr, epoch);
+    epoch = __atomic_load_n(&rec->ebr->epoch, __ATOMIC_SEQ_CST);
+    for(i = 0; i < EBR_LIMBO_LISTS; ++i) {
+        if(rec->limbo[i] && rec->limbo_epoch[i] + 2 <= epoch) {
+            hazard_node_t* const old = rec->limbo[i];
+            rec->limbo[i] = NULL;
+            ebr_free_list(old);
+        }
+    }
+    return advanced;
+}
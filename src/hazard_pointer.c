@@ -29,12 +29,33 @@ hazard_pointer_thread_record_t* hazard_pointer_thread_record_create_and_push(haz
     assert(head);
     assert(pointers_per_thread);
 
+    //take over a released record if there is one
+    cur = *head;
+    while(cur) {
+        int expected = 0;
+        if(!cur->active
+           && cur->hazard_pointers_count == pointers_per_thread
+           && __atomic_compare_exchange_n(&cur->active, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            hazard_node_t* node = __atomic_exchange_n(&cur->orphans, NULL, __ATOMIC_ACQUIRE);
+            while(node) {
+                hazard_node_t* const next = node->next;
+                node->next = cur->retired_list;
+                cur->retired_list = node;
+                ++cur->retired_count;
+                node = next;
+            }
+            return cur;
+        }
+        cur = cur->next;
+    }
+
     //create a new record
     sizeof_pointers = pointers_per_thread * sizeof(*((*head)->hazard_pointers));
     required_size = sizeof(hazard_pointer_thread_record_t) + sizeof_pointers;
     ret = (hazard_pointer_thread_record_t*)calloc(1, required_size);
     ret->head = head;
     ret->hazard_pointers_count = pointers_per_thread;
+    ret->active = 1;
     write_barrier();//finish all writes before exposing the record to the other threads
 
     //swap in the new record as the head
@@ -64,63 +85,100 @@ hazard_pointer_thread_record_t* hazard_pointer_thread_record_create_and_push(haz
     return ret;
 }
 
+void hazard_pointer_thread_record_release(hazard_pointer_thread_record_t* hptr)
+{
+    size_t i;
+    assert(hptr);
+    assert(hptr->active);
+    for(i = 0; i < hptr->hazard_pointers_count; ++i) {
+        hazard_pointer_done_using(hptr, i);
+    }
+    if(hptr->retired_list) {
+        hazard_pointer_scan(hptr);
+    }
+    //orphans was emptied when this record was claimed, and only the owner adds to it
+    assert(!hptr->orphans);
+    if(hptr->retired_list) {
+        __atomic_store_n(&hptr->orphans, hptr->retired_list, __ATOMIC_RELEASE);
+        hptr->retired_list = NULL;
+        hptr->retired_count = 0;
+    }
+    __atomic_store_n(&hptr->active, 0, __ATOMIC_RELEASE);
+}
+
+//hptr must not be reachable by other threads' scans any more
+static void hazard_pointer_thread_record_free(hazard_pointer_thread_record_t* hptr)
+{
+    hazard_pointer_scan(hptr);//frees everything unless hptr->head still leads to a record with a hazard pointer set
+    assert(!hptr->retired_list);
+    free(hptr->plist);
+    free(hptr);
+}
+
 void hazard_pointer_thread_record_destroy_all(hazard_pointer_thread_record_t* head)
 {
     hazard_pointer_thread_record_t* cur = head;
+    //no thread is using the records any more; without this, nodes protected by a stale hazard pointer in a later record would leak with the record being destroyed
+    while(cur) {
+        memset(cur->hazard_pointers, 0, cur->hazard_pointers_count * sizeof(*cur->hazard_pointers));
+        cur = cur->next;
+    }
+    cur = head;
     while(cur) {
         hazard_pointer_thread_record_t* next;
         cur->head = &cur;
         next = cur->next;
-        hazard_pointer_thread_record_destroy(cur);
+        hazard_pointer_thread_record_free(cur);
         cur = next;
     }
 }
 
 void hazard_pointer_thread_record_destroy(hazard_pointer_thread_record_t* hptr)
 {
-    if(hptr) {
-        hazard_pointer_scan(hptr);//attempt to cleanup; best effort only here. really no threads should still be using these hazard pointers, so all should be freed
-        free(hptr->plist);
+    hazard_pointer_thread_record_t* cur;
+    if(!hptr) {
+        return;
     }
-    free(hptr);
+    for(cur = *hptr->head; cur; cur = cur->next) {
+        if(cur == hptr) {
+            //other threads' scans still walk hptr, so it can't be freed. leftovers become orphans instead of leaking
+            if(hptr->active) {
+                hazard_pointer_thread_record_release(hptr);
+            }
+            return;
+        }
+    }
+    hazard_pointer_thread_record_free(hptr);
 }
 
-static inline int hazard_pointer_compare(const void* p_one, const void* p_two)
+//plist is an open addressing hash set of the live hazard pointers, with a power of 2 number of slots. NULL marks an empty slot.
+static inline size_t hazard_pointer_hash(const hazard_node_t* node, size_t mask)
 {
-    const uintptr_t one = *(uintptr_t*)p_one;
-    const uintptr_t two = *(uintptr_t*)p_two;
-    if(one == two) {
-        return 0;
-    }
-    return one < two ? -1 : 1;
+    //nodes are at least pointer aligned; drop the low bits and mix the rest (fibonacci hashing)
+    const uint64_t h = ((uint64_t)(uintptr_t)node >> 3) * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h >> 32) & mask;
 }
 
-static int binary_search(void** haystack, ssize_t haystack_size, void* needle)
+static inline void hazard_pointer_set_insert(hazard_node_t** set, size_t mask, hazard_node_t* node)
 {
-    ssize_t start;
-    ssize_t end;
-
-    assert(haystack);
-    if(!haystack_size) {
-        return 0;
+    size_t i = hazard_pointer_hash(node, mask);
+    while(set[i]) {
+        if(set[i] == node) {
+            return;
+        }
+        i = (i + 1) & mask;
     }
-    start = 0;
-    end = haystack_size - 1;
-    while(start <= end) {
-        ssize_t middle;
-        void *middle_value;
-        assert(start >= 0 && start < haystack_size);
-        assert(end >= 0 && end < haystack_size);
-        middle = (start + end) / 2;
-        assert(middle >= 0 && middle < haystack_size);
-        middle_value = haystack[middle];
-        if(middle_value > needle) {
-            end = middle - 1;
-        } else if(middle_value < needle) {
-            start = middle + 1;
-        } else {
+    set[i] = node;
+}
+
+static inline int hazard_pointer_set_contains(hazard_node_t* const* set, size_t mask, const hazard_node_t* node)
+{
+    size_t i = hazard_pointer_hash(node, mask);
+    while(set[i]) {
+        if(set[i] == node) {
             return 1;
         }
+        i = (i + 1) & mask;
     }
     return 0;
 }
@@ -129,39 +187,57 @@ void hazard_pointer_scan(hazard_pointer_thread_record_t* hptr)
 {
     hazard_pointer_thread_record_t *head, *cur_record;
     hazard_node_t* node;
-    size_t index, i, max_pointers;
+    size_t i, max_pointers, set_size, mask;
 
     assert(hptr);
     //head always has a correct retired_threshold; that is, retired_threshold = 2 * N * K
     head = *hptr->head;
     assert(head);
     max_pointers = head->retire_threshold / 2;
-    if(!hptr->plist || hptr->plist_size < max_pointers) {
+    //keep the set at most half full so probe sequences stay short
+    set_size = 2;
+    while(set_size < 2 * max_pointers) {
+        set_size *= 2;
+    }
+    if(!hptr->plist || hptr->plist_size < set_size) {
         free(hptr->plist);
-        hptr->plist_size = max_pointers;
-        hptr->plist = (hazard_node_t**)malloc(max_pointers * sizeof(*hptr->plist));
+        hptr->plist_size = set_size;
+        hptr->plist = (hazard_node_t**)malloc(set_size * sizeof(*hptr->plist));
     }
+    set_size = hptr->plist_size;
+    mask = set_size - 1;
+    memset(hptr->plist, 0, set_size * sizeof(*hptr->plist));
+
+    //any hazard pointer published before this point is visible below
+    asymmetric_barrier_heavy();
 
-    index = 0;
     cur_record = head;
     while(cur_record) {
         size_t hazard_pointers_count;
         hazard_node_t **hazard_pointers;
-        assert(index < max_pointers);
         hazard_pointers_count = cur_record->hazard_pointers_count;
         hazard_pointers = &*cur_record->hazard_pointers;
         for(i = 0; i < hazard_pointers_count; ++i) {
             hazard_node_t* const h = hazard_pointers[i];
             if(h) {
-                hptr->plist[index] = h;
-                ++index;
+                hazard_pointer_set_insert(hptr->plist, mask, h);
+            }
+        }
+        //adopt nodes left behind by a released record. that includes hptr itself when it's released, as when destroy() scans it
+        if((cur_record != hptr || !hptr->active)
+           && __atomic_load_n(&cur_record->orphans, __ATOMIC_RELAXED)
+           && !__atomic_load_n(&cur_record->active, __ATOMIC_ACQUIRE)) {
+            node = __atomic_exchange_n(&cur_record->orphans, NULL, __ATOMIC_ACQUIRE);
+            while(node) {
+                hazard_node_t* const next = node->next;
+                node->next = hptr->retired_list;
+                hptr->retired_list = node;
+                node = next;
             }
         }
         cur_record = cur_record->next;
     }
 
-    qsort(hptr->plist, index, sizeof(*hptr->plist), &hazard_pointer_compare);
-
     node = hptr->retired_list;
     hptr->retired_list = NULL;
     hptr->retired_count = 0;
@@ -169,7 +245,7 @@ void hazard_pointer_scan(hazard_pointer_thread_record_t* hptr)
     while(node) {
         hazard_node_t* const next = node->next;
 
-        const int is_hazardous = binary_search((void**)hptr->plist, (ssize_t) index, node);
+        const int is_hazardous = hazard_pointer_set_contains(hptr->plist, mask, node);
 
         if(is_hazardous) {
             node->next = hptr->retired_list;
@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include <fibconcurrent/mpmc_ring_queue.h>
+#include <fibconcurrent/machine_specific.h>
+
+#include "mpmc_ring_queue_internal.h"
+
+qerr_t mpmc_ring_queue_create(mpmc_ring_queue_t **q, size_t q_size) {
+    size_t i;
+    mpmc_ring_queue_t *ret;
+    q_msg_t *msgs;
+    qerr_t err;
+
+    assert(q);
+    *q = NULL;
+    if ((err = queue_size_is_valid(q_size)) != QERR_OK) {
+        return err;
+    }
+
+    if (posix_memalign((void **)&ret, CACHE_LINE_SIZE, sizeof(*ret)) != 0) {
+        return QERR_MALLOCERR;
+    }
+    memset(ret, 0, sizeof(*ret));
+
+    if (posix_memalign((void **)&msgs, CACHE_LINE_SIZE,
+                       q_size * sizeof(q_msg_t)) != 0) {
+        free(ret);
+        return QERR_MALLOCERR;
+    }
+
+    /* slot i is free for the producer holding put_pos == i */
+    for (i = 0; i < q_size; i++) {
+        msgs[i].d = NULL;
+        msgs[i].seq = i;
+    }
+    ret->msgs = msgs;
+    ret->capacity = q_size;
+    ret->capacity_mod = q_size - 1;
+    ret->put_pos = 0;
+    ret->get_pos = 0;
+
+    *q = ret;
+    return QERR_OK;
+} /* mpmc_ring_queue_create */
+
+void mpmc_ring_queue_destroy(mpmc_ring_queue_t *q, free_func free_fn) {
+    if (q) {
+        if (free_fn) {
+            void *d;
+            while (mpmc_ring_queue_dequeue(q, &d) == QERR_OK) {
+                free_fn(d);
+            }
+        }
+        free((void *)q->msgs);
+        free(q);
+    }
+} /* mpmc_ring_queue_destroy */
+
+qerr_t mpmc_ring_queue_enqueue(mpmc_ring_queue_t *q, void *d) {
+    q_msg_t *msg;
+    size_t pos;
+
+    assert(q);
+    pos = __atomic_load_n(&q->put_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        size_t seq;
+        intptr_t dif;
+
+        msg = &q->msgs[pos & q->capacity_mod];
+        seq = __atomic_load_n(&msg->seq, __ATOMIC_ACQUIRE);
+        dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            /* the slot is free for this lap, try to claim it */
+            if (__atomic_compare_exchange_n(&q->put_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+            /* pos is reloaded by a failed CAS */
+        } else if (dif < 0) {
+            /* the slot still holds a message from the previous lap */
+            return QERR_FULL;
+        } else {
+            /* another producer claimed the slot, catch up */
+            pos = __atomic_load_n(&q->put_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    msg->d = d;
+    /* publish the message for the consumer holding get_pos == pos */
+    __atomic_store_n(&msg->seq, pos + 1, __ATOMIC_RELEASE);
+    return QERR_OK;
+} /* mpmc_ring_queue_enqueue */
+
+qerr_t mpmc_ring_queue_dequeue(mpmc_ring_queue_t *q, void **d) {
+    q_msg_t *msg;
+    size_t pos;
+
+    assert(q);
+    assert(d);
+    pos = __atomic_load_n(&q->get_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        size_t seq;
+        intptr_t dif;
+
+        msg = &q->msgs[pos & q->capacity_mod];
+        seq = __atomic_load_n(&msg->seq, __ATOMIC_ACQUIRE);
+        dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&q->get_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (dif < 0) {
+            /* the slot was not written for this lap yet */
+            return QERR_EMPTY;
+        } else {
+            pos = __atomic_load_n(&q->get_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    *d = (void *)msg->d;
+    /* free the slot for the producer of the next lap */
+    __atomic_store_n(&msg->seq, pos + q->capacity_mod + 1, __ATOMIC_RELEASE);
+    return QERR_OK;
+} /* mpmc_ring_queue_dequeue */
+
+size_t mpmc_ring_queue_capacity(const mpmc_ring_queue_t *q) {
+    assert(q);
+    return q->capacity;
+} /* mpmc_ring_queue_capacity */
+
+size_t mpmc_ring_queue_len(const mpmc_ring_queue_t *q) {
+    size_t get_pos, put_pos;
+
+    assert(q);
+    /* read get_pos first; the queue will look larger or equal to its actual size */
+    get_pos = __atomic_load_n(&q->get_pos, __ATOMIC_ACQUIRE);
+    put_pos = __atomic_load_n(&q->put_pos, __ATOMIC_ACQUIRE);
+    if (put_pos <= get_pos) {
+        return 0;
+    }
+    put_pos -= get_pos;
+    return put_pos > q->capacity ? q->capacity : put_pos;
+} /* mpmc_ring_queue_len */
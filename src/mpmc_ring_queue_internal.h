@@ -14,7 +14,7 @@ struct q_msg_s {
 };
 typedef struct q_msg_s q_msg_t;
 
-/* queue.h contains an empty forward definition of "q_s", and defines "queue" */
+/* mpmc_ring_queue.h contains an empty forward definition of "mpmc_q_s", and defines "mpmc_ring_queue_t" */
 struct mpmc_q_s {
     size_t put_pos; /* next put position (tail pointer) */
     char _put_pad[CACHE_LINE_SIZE -
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/mpsc_event_fifo.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
+int mpsc_event_fifo_init(mpsc_event_fifo_t* f)
+{
+    assert(f);
+    f->signaled = 0;
+#if HAVE_EVENTFD
+    f->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    f->write_fd = f->fd;
+    if(f->fd < 0) {
+        return 0;
+    }
+#else
+    {
+        int fds[2];
+        if(pipe(fds)) {
+            return 0;
+        }
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, O_NONBLOCK);
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        f->fd = fds[0];
+        f->write_fd = fds[1];
+    }
+#endif
+    if(!mpsc_fifo_init(&f->fifo)) {
+        mpsc_event_fifo_destroy(f);
+        return 0;
+    }
+    return 1;
+}
+
+void mpsc_event_fifo_destroy(mpsc_event_fifo_t* f)
+{
+    if(f) {
+        mpsc_fifo_destroy(&f->fifo);
+        if(f->write_fd != f->fd) {
+            close(f->write_fd);
+        }
+        close(f->fd);
+        f->fd = -1;
+        f->write_fd = -1;
+    }
+}
+
+void mpsc_event_fifo_signal(mpsc_event_fifo_t* f)
+{
+#if HAVE_EVENTFD
+    const uint64_t one = 1;
+#else
+    const char one = 1;
+#endif
+    assert(f);
+    //EAGAIN means the descriptor is readable already
+    while(write(f->write_fd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+}
+
+void mpsc_event_fifo_rearm(mpsc_event_fifo_t* f)
+{
+    char buf[64];
+    assert(f);
+    //an eventfd is reset by a single read; a pipe is read until it's empty
+    while(1) {
+        const ssize_t ret = read(f->fd, buf, HAVE_EVENTFD ? sizeof(uint64_t) : sizeof(buf));
+        if(ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if(HAVE_EVENTFD || ret <= 0) {
+            break;
+        }
+    }
+    //pairs with the producer's exchange on tail; the caller drains after this
+    __atomic_store_n(&f->signaled, 0, __ATOMIC_SEQ_CST);
+}
@@ -7,7 +7,8 @@
  * It is used by the q_qerr_str() function. */
 static const char *qerrs[] = {"QERR_OK",      "QERR_BUG1",      "QERR_BUG2",
                               "QERR_BADSIZE", "QERR_MALLOCERR", "QERR_FULL",
-                              "QERR_EMPTY",   "BAD_QERR",       NULL};
+                              "QERR_EMPTY",   "QERR_SYSERR",    "QERR_BADFORMAT",
+                              "BAD_QERR",     NULL};
 #define BAD_QERR (sizeof(qerrs) / sizeof(qerrs[0]) - 2)
 
 /* Internal function: return 1 if power of 2 */
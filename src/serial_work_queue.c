@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <fibconcurrent/serial_work_queue.h>
+#include <fibconcurrent/machine_specific.h>
+
+void serial_work_queue_init(serial_work_queue_t* q)
+{
+    assert(q);
+    q->stub.next = NULL;
+    q->head = &q->stub;
+    q->tail = (uintptr_t)&q->stub | SERIAL_WORK_QUEUE_IDLE;
+}
+
+int serial_work_queue_push(serial_work_queue_t* q, mpsc_intrusive_node_t* item)
+{
+    uintptr_t prev_tail;
+    assert(q);
+    assert(item);
+    assert(!((uintptr_t)item & SERIAL_WORK_QUEUE_IDLE));
+    item->next = NULL;
+    prev_tail = __atomic_exchange_n(&q->tail, (uintptr_t)item, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&((mpsc_intrusive_node_t*)(prev_tail & ~SERIAL_WORK_QUEUE_IDLE))->next, item, __ATOMIC_RELEASE);
+    return (prev_tail & SERIAL_WORK_QUEUE_IDLE) ? WORK_QUEUE_START_WORKING : WORK_QUEUE_QUEUED;
+}
+
+//as mpsc_intrusive_fifo_trypop(). the tail is never tagged while there is a worker.
+static mpsc_intrusive_node_t* serial_work_queue_trypop(serial_work_queue_t* q)
+{
+    mpsc_intrusive_node_t* head = q->head;
+    mpsc_intrusive_node_t* next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    if(head == &q->stub) {
+        if(!next) {
+            return __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) == (uintptr_t)head ? MPSC_INTRUSIVE_EMPTY : MPSC_INTRUSIVE_RETRY;
+        }
+        //skip the stub
+        q->head = head = next;
+        next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    }
+    if(next) {
+        q->head = next;
+        return head;
+    }
+    if(__atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) != (uintptr_t)head) {
+        //a producer is between its exchange and linking to head
+        return MPSC_INTRUSIVE_RETRY;
+    }
+    //head is the last node; push the stub behind it so head can be returned
+    serial_work_queue_push(q, &q->stub);
+    next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    if(next) {
+        q->head = next;
+        return head;
+    }
+    return MPSC_INTRUSIVE_RETRY;
+}
+
+int serial_work_queue_get_work(serial_work_queue_t* q, mpsc_intrusive_node_t** out)
+{
+    assert(q);
+    assert(out);
+    while(1) {
+        mpsc_intrusive_node_t* const node = serial_work_queue_trypop(q);
+        if(node == MPSC_INTRUSIVE_EMPTY) {
+            uintptr_t expected = (uintptr_t)&q->stub;
+            if(__atomic_compare_exchange_n(&q->tail, &expected, expected | SERIAL_WORK_QUEUE_IDLE, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                *out = NULL;
+                return WORK_QUEUE_EMPTY;
+            }
+            //a push landed after trypop looked; it will be linked shortly
+        } else if(node != MPSC_INTRUSIVE_RETRY) {
+            *out = node;
+            return WORK_QUEUE_MORE_WORK;
+        }
+        cpu_relax();
+    }
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <fibconcurrent/shm_ring.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static uint64_t shm_ring_slot_size(size_t msg_size)
+{
+    const uint64_t size = sizeof(shm_ring_slot_t) + (uint64_t)msg_size;
+    return (size + CACHE_LINE_SIZE - 1) & ~(uint64_t)(CACHE_LINE_SIZE - 1);
+}
+
+static int shm_ring_open_fd(const char* name)
+{
+    if(name) {
+        return shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    }
+#if HAVE_MEMFD_CREATE
+    return memfd_create("shm_ring", MFD_CLOEXEC);
+#else
+    {
+        static unsigned int counter = 0;
+        char tmp_name[64];
+        int fd;
+        snprintf(tmp_name, sizeof(tmp_name), "/shm_ring.%d.%u", (int)getpid(), __sync_add_and_fetch(&counter, 1));
+        fd = shm_open(tmp_name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+        if(fd >= 0) {
+            shm_unlink(tmp_name);
+        }
+        return fd;
+    }
+#endif
+}
+
+static shm_ring_t* shm_ring_alloc_handle()
+{
+    void* ret = NULL;
+    if(posix_memalign(&ret, CACHE_LINE_SIZE, sizeof(shm_ring_t))) {
+        return NULL;
+    }
+    memset(ret, 0, sizeof(shm_ring_t));
+    ((shm_ring_t*)ret)->fd = -1;
+    return (shm_ring_t*)ret;
+}
+
+//geometry is a validated private copy of header's fields (or header itself when we created it); the shared header isn't re-read for them
+static void shm_ring_set_geometry(shm_ring_t* r, shm_ring_header_t* header, const shm_ring_header_t* geometry)
+{
+    r->header = header;
+    r->slots = (uint8_t*)header + geometry->slots_offset;
+    r->mask = geometry->capacity - 1;
+    r->slot_size = geometry->slot_size;
+    r->msg_size = geometry->msg_size;
+    r->mode = geometry->mode;
+    r->map_size = (size_t)geometry->map_size;
+    //indices are always masked, so any value is safe here
+    r->head_cache = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+    r->tail_cache = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+}
+
+qerr_t shm_ring_create(shm_ring_t** r, const char* name, uint32_t mode, size_t capacity, size_t msg_size)
+{
+    shm_ring_t* ret;
+    shm_ring_header_t* header;
+    uint64_t slot_size, slots_offset, map_size, i;
+    qerr_t err;
+
+    assert(r);
+    *r = NULL;
+    if((err = queue_size_is_valid(capacity)) != QERR_OK) {
+        return err;
+    }
+    if((mode != SHM_RING_SPSC && mode != SHM_RING_MPSC) || !msg_size || msg_size > UINT32_MAX) {
+        return QERR_BADSIZE;
+    }
+    slot_size = shm_ring_slot_size(msg_size);
+    slots_offset = sizeof(shm_ring_header_t);
+    map_size = slots_offset + capacity * slot_size;
+
+    if(!(ret = shm_ring_alloc_handle())) {
+        return QERR_MALLOCERR;
+    }
+    ret->fd = shm_ring_open_fd(name);
+    if(ret->fd < 0) {
+        free(ret);
+        return QERR_SYSERR;
+    }
+    if(ftruncate(ret->fd, (off_t)map_size)) {
+        goto err_fd;
+    }
+    header = (shm_ring_header_t*)mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, ret->fd, 0);
+    if(header == MAP_FAILED) {
+        goto err_fd;
+    }
+
+    //the object is zero filled by ftruncate()
+    header->version = SHM_RING_VERSION;
+    header->mode = mode;
+    header->msg_size = (uint32_t)msg_size;
+    header->capacity = capacity;
+    header->slot_size = slot_size;
+    header->slots_offset = slots_offset;
+    header->map_size = map_size;
+    header->tail = 0;
+    header->head = 0;
+    shm_ring_set_geometry(ret, header, header);
+    if(mode == SHM_RING_MPSC) {
+        //slot i is free for the producer holding tail == i
+        for(i = 0; i < capacity; ++i) {
+            shm_ring_slot(ret, i)->seq = i;
+        }
+    }
+    __atomic_store_n(&header->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+
+    *r = ret;
+    return QERR_OK;
+
+err_fd:
+    close(ret->fd);
+    if(name) {
+        shm_unlink(name);
+    }
+    free(ret);
+    return QERR_SYSERR;
+}
+
+//header must be a private copy; a peer could change the shared one between validating and using it
+static qerr_t shm_ring_validate(const shm_ring_header_t* header, uint64_t file_size)
+{
+    if(header->magic != SHM_RING_MAGIC
+       || header->version != SHM_RING_VERSION
+       || (header->mode != SHM_RING_SPSC && header->mode != SHM_RING_MPSC)
+       || header->msg_size == 0
+       || queue_size_is_valid((size_t)header->capacity) != QERR_OK
+       || header->slot_size < shm_ring_slot_size(header->msg_size)
+       || header->slots_offset < sizeof(shm_ring_header_t)
+       || header->map_size > file_size
+       || header->slots_offset > header->map_size
+       || header->capacity > (header->map_size - header->slots_offset) / header->slot_size) {
+        return QERR_BADFORMAT;
+    }
+    return QERR_OK;
+}
+
+qerr_t shm_ring_attach(shm_ring_t** r, int fd)
+{
+    shm_ring_t* ret;
+    shm_ring_header_t* header;
+    shm_ring_header_t geometry;
+    struct stat st;
+    qerr_t err;
+
+    assert(r);
+    *r = NULL;
+    if(fstat(fd, &st)) {
+        return QERR_SYSERR;
+    }
+    if((uint64_t)st.st_size < sizeof(shm_ring_header_t)) {
+        return QERR_BADFORMAT;
+    }
+    if(!(ret = shm_ring_alloc_handle())) {
+        return QERR_MALLOCERR;
+    }
+    ret->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if(ret->fd < 0) {
+        free(ret);
+        return QERR_SYSERR;
+    }
+    header = (shm_ring_header_t*)mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, ret->fd, 0);
+    if(header == MAP_FAILED) {
+        err = QERR_SYSERR;
+        goto err_fd;
+    }
+    //the magic is stored last by the creator; copy the rest once it's seen, then only use the copy.
+    //atomic loads so the compiler reads each field exactly once instead of going back to the shared header
+    geometry.magic = __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE);
+    geometry.version = __atomic_load_n(&header->version, __ATOMIC_RELAXED);
+    geometry.mode = __atomic_load_n(&header->mode, __ATOMIC_RELAXED);
+    geometry.msg_size = __atomic_load_n(&header->msg_size, __ATOMIC_RELAXED);
+    geometry.capacity = __atomic_load_n(&header->capacity, __ATOMIC_RELAXED);
+    geometry.slot_size = __atomic_load_n(&header->slot_size, __ATOMIC_RELAXED);
+    geometry.slots_offset = __atomic_load_n(&header->slots_offset, __ATOMIC_RELAXED);
+    geometry.map_size = __atomic_load_n(&header->map_size, __ATOMIC_RELAXED);
+    if((err = shm_ring_validate(&geometry, (uint64_t)st.st_size)) != QERR_OK) {
+        munmap(header, (size_t)st.st_size);
+        goto err_fd;
+    }
+    shm_ring_set_geometry(ret, header, &geometry);
+    //the whole file is mapped; unmap all of it on close
+    ret->map_size = (size_t)st.st_size;
+
+    *r = ret;
+    return QERR_OK;
+
+err_fd:
+    close(ret->fd);
+    free(ret);
+    return err;
+}
+
+qerr_t shm_ring_open(shm_ring_t** r, const char* name)
+{
+    qerr_t err;
+    int fd;
+
+    assert(r);
+    assert(name);
+    *r = NULL;
+    fd = shm_open(name, O_RDWR, 0);
+    if(fd < 0) {
+        return QERR_SYSERR;
+    }
+    err = shm_ring_attach(r, fd);
+    close(fd);
+    return err;
+}
+
+void shm_ring_close(shm_ring_t* r)
+{
+    if(r) {
+        munmap(r->header, r->map_size);
+        close(r->fd);
+        free(r);
+    }
+}
+
+int shm_ring_unlink(const char* name)
+{
+    assert(name);
+    return shm_unlink(name) == 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/spsc_wait_fifo.h>
+
+#if HAVE_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include <unistd.h>
+
+void spsc_wait_fifo_wait(spsc_wait_fifo_t* f)
+{
+    assert(f);
+    while(__atomic_load_n(&f->sleeping, __ATOMIC_ACQUIRE)) {
+#if HAVE_FUTEX
+        //returns immediately if the producer already cleared the flag
+        syscall(SYS_futex, &f->sleeping, FUTEX_WAIT_PRIVATE, 1, NULL, NULL, 0);
+#else
+        usleep(1);
+#endif
+    }
+}
+
+void spsc_wait_fifo_wake(spsc_wait_fifo_t* f)
+{
+    assert(f);
+    if(__atomic_exchange_n(&f->sleeping, 0, __ATOMIC_RELEASE)) {
+#if HAVE_FUTEX
+        syscall(SYS_futex, &f->sleeping, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+    }
+}
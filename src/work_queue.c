@@ -16,12 +16,42 @@
 
 #include <fibconcurrent/work_queue.h>
 #include <fibconcurrent/machine_specific.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+//the address is unique per thread
+static __thread char work_queue_thread_token;
+
+//nodes popped by a worker are cached and reused by that thread's next execute(). mpsc_fifo hands back a different node than the one pushed, so the cache moves nodes between threads.
+#define WORK_QUEUE_NODE_CACHE_MAX 64
+static __thread work_queue_item_t* work_queue_node_cache = NULL;
+static __thread size_t work_queue_node_cache_size = 0;
+//the cache is freed by a thread specific data destructor when the thread exits
+static __thread int work_queue_node_cache_registered = 0;
+static pthread_key_t work_queue_node_cache_key;
+static pthread_once_t work_queue_node_cache_once = PTHREAD_ONCE_INIT;
+
+static uint64_t work_queue_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
 
 int work_queue_init(work_queue_t* wq)
 {
     assert(wq);
     wq->in_count = 0;
     wq->out_count = 0;
+    wq->budget_used = 0;
+    wq->budget_start = 0;
+    wq->offer = WORK_QUEUE_OFFER_NONE;
+    wq->offer_owner = NULL;
+    wq->max_items = 0;
+    wq->max_ns = 0;
+    wq->executor = NULL;
+    wq->executor_arg = NULL;
     if(!mpsc_fifo_init(&wq->fifo)) {
         return 0;
     }
@@ -35,6 +65,96 @@ void work_queue_destroy(work_queue_t* wq)
     }
 }
 
+void work_queue_set_budget(work_queue_t* wq, uint64_t max_items, uint64_t max_ns)
+{
+    assert(wq);
+    wq->max_items = max_items;
+    wq->max_ns = max_ns;
+}
+
+void work_queue_set_executor(work_queue_t* wq, work_queue_executor_t executor, void* arg)
+{
+    assert(wq);
+    wq->executor = executor;
+    wq->executor_arg = arg;
+}
+
+//called by a pusher which did not become the worker. if the worker has offered the queue, take it over.
+static int work_queue_try_accept(work_queue_t* wq)
+{
+    int expected = WORK_QUEUE_OFFER_OFFERED;
+    if(__atomic_load_n(&wq->offer, __ATOMIC_ACQUIRE) != WORK_QUEUE_OFFER_OFFERED
+       || wq->offer_owner == &work_queue_thread_token) {
+        return WORK_QUEUE_QUEUED;
+    }
+    if(!__atomic_compare_exchange_n(&wq->offer, &expected, WORK_QUEUE_OFFER_ACCEPTED, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return WORK_QUEUE_QUEUED;
+    }
+    //the old worker stops once it calls get_work() again. our item is counted in in_count, so it cannot run out of work first.
+    while(__atomic_load_n(&wq->offer, __ATOMIC_ACQUIRE) != WORK_QUEUE_OFFER_RELEASED) {
+        cpu_relax();
+    }
+    __atomic_store_n(&wq->offer, WORK_QUEUE_OFFER_NONE, __ATOMIC_RELAXED);
+    return WORK_QUEUE_START_WORKING;
+}
+
+//give up being the worker after a pusher accepted the offer
+static void work_queue_release(work_queue_t* wq)
+{
+    wq->budget_used = 0;
+    wq->budget_start = 0;
+    __atomic_store_n(&wq->offer, WORK_QUEUE_OFFER_RELEASED, __ATOMIC_RELEASE);
+}
+
+//called by the worker before taking more items. returns 1 if the queue has been handed off.
+static int work_queue_check_budget(work_queue_t* wq)
+{
+    if(__atomic_load_n(&wq->offer, __ATOMIC_ACQUIRE) == WORK_QUEUE_OFFER_ACCEPTED) {
+        work_queue_release(wq);
+        return 1;
+    }
+    if((!wq->max_items || wq->budget_used < wq->max_items)
+       && (!wq->max_ns || !wq->budget_start || work_queue_now_ns() - wq->budget_start < wq->max_ns)) {
+        return 0;
+    }
+    if(wq->executor) {
+        wq->budget_used = 0;
+        wq->budget_start = 0;
+        //the executor's thread may start working immediately; wq belongs to it now
+        wq->executor(wq, wq->executor_arg);
+        return 1;
+    }
+    if(wq->offer == WORK_QUEUE_OFFER_NONE) {
+        wq->offer_owner = &work_queue_thread_token;
+        __atomic_store_n(&wq->offer, WORK_QUEUE_OFFER_OFFERED, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+static void work_queue_charge_budget(work_queue_t* wq, size_t count)
+{
+    wq->budget_used += count;
+    if(wq->max_ns && !wq->budget_start) {
+        wq->budget_start = work_queue_now_ns();
+    }
+}
+
+//called by the worker before it may declare the queue empty. returns 1 if the queue has been handed off instead.
+//the budget is reset here since a new worker may start as soon as in_count drops to zero.
+static int work_queue_withdraw_offer(work_queue_t* wq)
+{
+    int expected = WORK_QUEUE_OFFER_OFFERED;
+    if(wq->offer == WORK_QUEUE_OFFER_NONE
+       || __atomic_compare_exchange_n(&wq->offer, &expected, WORK_QUEUE_OFFER_NONE, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        wq->budget_used = 0;
+        wq->budget_start = 0;
+        return 0;
+    }
+    //a pusher accepted; its item keeps the queue non-empty
+    work_queue_release(wq);
+    return 1;
+}
+
 int work_queue_push(work_queue_t* wq, work_queue_item_t* item)
 {
     int64_t in_count;
@@ -47,6 +167,9 @@ int work_queue_push(work_queue_t* wq, work_queue_item_t* item)
         ret = WORK_QUEUE_START_WORKING;
     }
     mpsc_fifo_push(&wq->fifo, item);
+    if(ret == WORK_QUEUE_QUEUED) {
+        ret = work_queue_try_accept(wq);
+    }
     return ret;
 }
 
@@ -54,10 +177,17 @@ int work_queue_get_work(work_queue_t* wq, work_queue_item_t** out)
 {
     assert(wq);
     assert(out);
+    if(work_queue_check_budget(wq)) {
+        *out = NULL;
+        return WORK_QUEUE_HANDOFF;
+    }
     while(!(*out = mpsc_fifo_trypop(&wq->fifo))) {
         if(wq->out_count == wq->in_count) {
             int64_t new_in_count;
             const int64_t old_out_count = wq->out_count;
+            if(work_queue_withdraw_offer(wq)) {
+                return WORK_QUEUE_HANDOFF;
+            }
             wq->out_count = 0;
             new_in_count = __sync_sub_and_fetch(&wq->in_count, old_out_count);
             if(new_in_count == 0) {
@@ -67,6 +197,164 @@ int work_queue_get_work(work_queue_t* wq, work_queue_item_t** out)
         cpu_relax();//another thread has pushed work, but hasn't finished pushing to the mpsc_fifo
     }
     wq->out_count += 1;
+    work_queue_charge_budget(wq, 1);
     return WORK_QUEUE_MORE_WORK;
 }
 
+int work_queue_push_batch(work_queue_t* wq, work_queue_item_t* first, size_t n)
+{
+    work_queue_item_t* last = first;
+    int64_t in_count;
+    int ret = WORK_QUEUE_QUEUED;
+    size_t i;
+    assert(wq);
+    assert(first);
+    assert(n > 0);
+    for(i = 1; i < n; ++i) {
+        last = last->next;
+        assert(last);
+    }
+    in_count = __sync_add_and_fetch(&wq->in_count, (int64_t)n);
+    if(in_count == (int64_t)n) {
+        //the queue was idle; we'll be the worker
+        ret = WORK_QUEUE_START_WORKING;
+    }
+    mpsc_fifo_push_chain(&wq->fifo, first, last);
+    if(ret == WORK_QUEUE_QUEUED) {
+        ret = work_queue_try_accept(wq);
+    }
+    return ret;
+}
+
+size_t work_queue_get_work_batch(work_queue_t* wq, work_queue_item_t** out, size_t max)
+{
+    size_t count;
+    assert(wq);
+    assert(out);
+    assert(max > 0);
+    if(work_queue_check_budget(wq)) {
+        return 0;
+    }
+    while(!(count = mpsc_fifo_pop_many(&wq->fifo, out, max))) {
+        if(wq->out_count == wq->in_count) {
+            int64_t new_in_count;
+            const int64_t old_out_count = wq->out_count;
+            if(work_queue_withdraw_offer(wq)) {
+                return 0;
+            }
+            wq->out_count = 0;
+            new_in_count = __sync_sub_and_fetch(&wq->in_count, old_out_count);
+            if(new_in_count == 0) {
+                return 0;
+            }
+        }
+        cpu_relax();//another thread has pushed work, but hasn't finished pushing to the mpsc_fifo
+    }
+    wq->out_count += count;
+    work_queue_charge_budget(wq, count);
+    return count;
+}
+
+//lives on the stack of the thread calling execute()
+typedef struct work_queue_request
+{
+    work_queue_fn_t fn;
+    void* arg;
+    volatile int done;
+} work_queue_request_t;
+
+static work_queue_item_t* work_queue_node_alloc()
+{
+    work_queue_item_t* const node = work_queue_node_cache;
+    if(node) {
+        work_queue_node_cache = node->next;
+        --work_queue_node_cache_size;
+        return node;
+    }
+    return (work_queue_item_t*)malloc(sizeof(work_queue_item_t));
+}
+
+static void work_queue_node_cache_destructor(void* value)
+{
+    (void)value;
+    work_queue_execute_thread_cleanup();
+}
+
+static void work_queue_node_cache_key_create()
+{
+    const int ret = pthread_key_create(&work_queue_node_cache_key, &work_queue_node_cache_destructor);
+    assert(ret == 0);
+    (void)ret;
+}
+
+static void work_queue_node_free(work_queue_item_t* node)
+{
+    if(work_queue_node_cache_size >= WORK_QUEUE_NODE_CACHE_MAX) {
+        free(node);
+        return;
+    }
+    if(!work_queue_node_cache_registered) {
+        //the destructor only runs for threads with a non-NULL value
+        pthread_once(&work_queue_node_cache_once, &work_queue_node_cache_key_create);
+        if(pthread_setspecific(work_queue_node_cache_key, &work_queue_node_cache_registered)) {
+            free(node);
+            return;
+        }
+        work_queue_node_cache_registered = 1;
+    }
+    node->next = work_queue_node_cache;
+    work_queue_node_cache = node;
+    ++work_queue_node_cache_size;
+}
+
+void work_queue_execute_drain(work_queue_t* wq)
+{
+    work_queue_item_t* item = NULL;
+    assert(wq);
+    while(work_queue_get_work(wq, &item) == WORK_QUEUE_MORE_WORK) {
+        work_queue_request_t* const request = (work_queue_request_t*)item->data;
+        work_queue_node_free(item);
+        request->fn(request->arg);
+        //the requester may return as soon as it sees done; request must not be touched after this store
+        __atomic_store_n(&request->done, 1, __ATOMIC_RELEASE);
+    }
+}
+
+int work_queue_execute(work_queue_t* wq, work_queue_fn_t fn, void* arg)
+{
+    work_queue_request_t request;
+    work_queue_item_t* node;
+    int spins = 0;
+    assert(wq);
+    assert(fn);
+    request.fn = fn;
+    request.arg = arg;
+    request.done = 0;
+    node = work_queue_node_alloc();
+    if(!node) {
+        return 0;
+    }
+    node->data = &request;
+    if(work_queue_push(wq, node) == WORK_QUEUE_START_WORKING) {
+        work_queue_execute_drain(wq);
+    }
+    //if the queue was handed off before our request ran, the new worker runs it
+    while(!__atomic_load_n(&request.done, __ATOMIC_ACQUIRE)) {
+        if(++spins < WORK_QUEUE_EXECUTE_SPIN_COUNT) {
+            cpu_relax();
+        } else {
+            sched_yield();
+        }
+    }
+    return 1;
+}
+
+void work_queue_execute_thread_cleanup()
+{
+    while(work_queue_node_cache) {
+        work_queue_item_t* const node = work_queue_node_cache;
+        work_queue_node_cache = node->next;
+        free(node);
+    }
+    work_queue_node_cache_size = 0;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/byte_ring_buffer.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 1000000
+#define NUM_PRODUCERS 3
+#define MAX_RECORD 300
+
+typedef struct record
+{
+    uint32_t producer;
+    uint32_t seq;
+    unsigned char payload[];
+} record_t;
+
+pthread_barrier_t barrier;
+byte_ring_buffer_t* rb;
+
+static size_t record_len(uint32_t seq)
+{
+    return sizeof(record_t) + (seq * 7919) % (MAX_RECORD - sizeof(record_t));
+}
+
+static void fill_record(void* p, size_t len, uint32_t producer, uint32_t seq)
+{
+    record_t* const r = (record_t*)p;
+    size_t i;
+    r->producer = producer;
+    r->seq = seq;
+    for(i = 0; i < len - sizeof(record_t); ++i) {
+        r->payload[i] = (unsigned char)(seq + i);
+    }
+}
+
+static int check_record(const void* p, size_t len, uint32_t producer, uint32_t seq)
+{
+    const record_t* const r = (const record_t*)p;
+    size_t i;
+    if(len != record_len(seq) || r->producer != producer || r->seq != seq) {
+        return 0;
+    }
+    for(i = 0; i < len - sizeof(record_t); ++i) {
+        if(r->payload[i] != (unsigned char)(seq + i)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+CTEST(byte_ring_buffer, huge_capacity)
+{
+    //rounding these up to a power of 2 would overflow
+    ASSERT_NULL(byte_ring_buffer_create(SIZE_MAX));
+    ASSERT_NULL(byte_ring_buffer_create(SIZE_MAX / 2 + 2));
+    ASSERT_NULL(byte_ring_buffer_create(BYTE_RING_BUFFER_MAX_CAPACITY + 1));
+}
+
+CTEST(byte_ring_buffer, wraparound)
+{
+    size_t len, i;
+    unsigned char* p;
+    byte_ring_buffer_t* small = byte_ring_buffer_create(1);
+    ASSERT_NOT_NULL(small);
+    ASSERT_TRUE(byte_ring_buffer_capacity(small) >= 4096);
+    ASSERT_NULL(byte_ring_buffer_read(small, &len));
+
+    //move the positions close to the end of the buffer
+    p = byte_ring_buffer_reserve(small, byte_ring_buffer_capacity(small) - 64);
+    ASSERT_NOT_NULL(p);
+    ASSERT_NULL(byte_ring_buffer_reserve(small, 128));
+    byte_ring_buffer_commit(small, p, 0);
+    ASSERT_TRUE(byte_ring_buffer_read(small, &len) == p);
+    ASSERT_EQUAL_U(0, len);
+    byte_ring_buffer_release(small);
+
+    //this record crosses the end of the buffer but is still contiguous
+    p = byte_ring_buffer_reserve(small, 1000);
+    ASSERT_NOT_NULL(p);
+    for(i = 0; i < 1000; ++i) {
+        p[i] = (unsigned char)i;
+    }
+    byte_ring_buffer_commit(small, p, 1000);
+    p = byte_ring_buffer_read(small, &len);
+    ASSERT_NOT_NULL(p);
+    ASSERT_EQUAL_U(1000, len);
+    for(i = 0; i < 1000; ++i) {
+        ASSERT_EQUAL(i & 0xFF, p[i]);
+    }
+    ASSERT_NULL(byte_ring_buffer_read(small, &len));
+    byte_ring_buffer_release(small);
+    byte_ring_buffer_destroy(small);
+}
+
+CTEST(byte_ring_buffer, out_of_order_commit)
+{
+    size_t len;
+    void *a, *b;
+    byte_ring_buffer_t* small = byte_ring_buffer_create(4096);
+    ASSERT_NOT_NULL(small);
+    a = byte_ring_buffer_reserve_mp(small, 10);
+    b = byte_ring_buffer_reserve_mp(small, 20);
+    ASSERT_NOT_NULL(a);
+    ASSERT_NOT_NULL(b);
+    byte_ring_buffer_commit(small, b, 15);
+    ASSERT_NULL(byte_ring_buffer_read(small, &len));
+    byte_ring_buffer_commit(small, a, 10);
+    ASSERT_TRUE(byte_ring_buffer_read(small, &len) == a);
+    ASSERT_EQUAL_U(10, len);
+    ASSERT_TRUE(byte_ring_buffer_read(small, &len) == b);
+    ASSERT_EQUAL_U(15, len);
+    byte_ring_buffer_release(small);
+    byte_ring_buffer_destroy(small);
+}
+
+void* spsc_push_func(void* p)
+{
+    uint32_t i;
+    (void) p;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        const size_t len = record_len(i);
+        void* out;
+        while(!(out = byte_ring_buffer_reserve(rb, len))) {
+            sched_yield();
+        }
+        fill_record(out, len, 0, i);
+        byte_ring_buffer_commit(rb, out, len);
+    }
+    return NULL;
+}
+
+void* mpsc_push_func(void* p)
+{
+    const uint32_t producer = (uint32_t)(intptr_t)p;
+    uint32_t i;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        const size_t len = record_len(i);
+        void* out;
+        while(!(out = byte_ring_buffer_reserve_mp(rb, len))) {
+            sched_yield();
+        }
+        fill_record(out, len, producer, i);
+        byte_ring_buffer_commit(rb, out, len);
+    }
+    return NULL;
+}
+
+static void consume(size_t producers)
+{
+    uint32_t next[NUM_PRODUCERS] = { 0 };
+    size_t i;
+    for(i = 0; i < PUSH_COUNT * producers;) {
+        size_t len;
+        const record_t* r;
+        size_t n = 0;
+        while((r = byte_ring_buffer_read(rb, &len))) {
+            ASSERT_TRUE(r->producer < producers);
+            ASSERT_TRUE(check_record(r, len, r->producer, next[r->producer]));
+            ++next[r->producer];
+            ++n;
+        }
+        if(n) {
+            byte_ring_buffer_release(rb);
+            i += n;
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+CTEST(byte_ring_buffer, spsc_threaded)
+{
+    pthread_t producer;
+    pthread_barrier_init(&barrier, NULL, 2);
+    rb = byte_ring_buffer_create(1 << 16);
+    ASSERT_NOT_NULL(rb);
+    pthread_create(&producer, NULL, &spsc_push_func, NULL);
+    pthread_barrier_wait(&barrier);
+    consume(1);
+    pthread_join(producer, NULL);
+    pthread_barrier_destroy(&barrier);
+    byte_ring_buffer_destroy(rb);
+}
+
+CTEST(byte_ring_buffer, mpsc_threaded)
+{
+    pthread_t producers[NUM_PRODUCERS];
+    intptr_t i;
+    pthread_barrier_init(&barrier, NULL, NUM_PRODUCERS + 1);
+    rb = byte_ring_buffer_create(1 << 16);
+    ASSERT_NOT_NULL(rb);
+    for(i = 0; i < NUM_PRODUCERS; ++i) {
+        pthread_create(&producers[i], NULL, &mpsc_push_func, (void*)i);
+    }
+    pthread_barrier_wait(&barrier);
+    consume(NUM_PRODUCERS);
+    for(i = 0; i < NUM_PRODUCERS; ++i) {
+        pthread_join(producers[i], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+    byte_ring_buffer_destroy(rb);
+}
+
+int main(int argc, const char *argv[]) {
+    return ctest_main(argc, argv);
+} /* main */
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <fibconcurrent/ebr.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PER_THREAD_COUNT 100000
+#define NUM_THREADS 4
+
+typedef struct test_object
+{
+    hazard_node_t hazard_node;
+    volatile intptr_t value;//poisoned when freed
+} test_object_t;
+
+ebr_t ebr;
+pthread_barrier_t barrier;
+test_object_t* volatile shared = NULL;
+volatile int bad_read = 0;
+int64_t freed = 0;
+
+void count_node(void* user_data, hazard_node_t* node)
+{
+    (void) user_data;
+    (void) node;
+    __sync_add_and_fetch(&freed, 1);
+}
+
+void free_node(void* user_data, hazard_node_t* node)
+{
+    test_object_t* const obj = (test_object_t*)node;
+    (void) user_data;
+    obj->value = -1;
+    __sync_add_and_fetch(&freed, 1);
+    free(obj);
+}
+
+CTEST(ebr, grace_period)
+{
+    ebr_thread_record_t *a, *b;
+    hazard_node_t node;
+    uint64_t epoch;
+
+    freed = 0;
+    node.gc_data = NULL;
+    node.gc_function = &count_node;
+    ebr_init(&ebr);
+    a = ebr_thread_record_create_and_push(&ebr);
+    b = ebr_thread_record_create_and_push(&ebr);
+    epoch = ebr.epoch;
+
+    ebr_enter(b);
+    ebr_retire(a, &node);
+    //b has seen the current epoch, so it can advance once
+    ASSERT_TRUE(ebr_collect(a));
+    ASSERT_EQUAL_U(epoch + 1, ebr.epoch);
+    //b is still in a critical section from the older epoch
+    ASSERT_FALSE(ebr_collect(a));
+    ASSERT_EQUAL(0, freed);
+
+    ebr_exit(b);
+    ASSERT_TRUE(ebr_collect(a));
+    ASSERT_EQUAL_U(epoch + 2, ebr.epoch);
+    ASSERT_EQUAL(1, freed);
+
+    //nested sections only leave on the outermost exit
+    ebr_enter(b);
+    ebr_enter(b);
+    ebr_exit(b);
+    ASSERT_TRUE(b->local_epoch & EBR_ACTIVE);
+    ebr_exit(b);
+    ASSERT_EQUAL_U(0, b->local_epoch);
+    ebr_destroy(&ebr);
+}
+
+void* run_function(void* param)
+{
+    ebr_thread_record_t* const rec = ebr_thread_record_create_and_push(&ebr);
+    intptr_t i;
+    (void) param;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PER_THREAD_COUNT; ++i) {
+        test_object_t* const obj = malloc(sizeof(*obj));
+        test_object_t* old;
+        obj->hazard_node.gc_data = NULL;
+        obj->hazard_node.gc_function = &free_node;
+        obj->value = i;
+        ebr_enter(rec);
+        old = __atomic_exchange_n(&shared, obj, __ATOMIC_SEQ_CST);
+        if(old) {
+            ebr_retire(rec, &old->hazard_node);
+        }
+        old = shared;
+        if(old && old->value < 0) {
+            bad_read = 1;
+        }
+        ebr_exit(rec);
+    }
+    return NULL;
+}
+
+CTEST(ebr, threaded)
+{
+    pthread_t threads[NUM_THREADS];
+    intptr_t i;
+
+    freed = 0;
+    ebr_init(&ebr);
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&threads[i], NULL, &run_function, NULL);
+    }
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    ASSERT_FALSE(bad_read);
+    //everything but the last object was retired, and most of it freed while running
+    ASSERT_TRUE(freed > 0);
+    ebr_destroy(&ebr);
+    ASSERT_EQUAL(NUM_THREADS * PER_THREAD_COUNT - 1, freed);
+    free(shared);
+    shared = NULL;
+}
+
+int main(int argc, const char *argv[])
+{
+    return ctest_main(argc, argv);
+} /* main */
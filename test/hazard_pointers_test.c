@@ -89,7 +89,7 @@ void* run_function(void* param)
     return NULL;
 }
 
-CTEST(hazard_pointer, threaded)
+static void run_threaded()
 {
     const size_t BUFFER_SIZE = NUM_THREADS * 2 * NUM_THREADS * POINTERS_PER_THREAD; //each thread can have up to 2 * N * K, so we need up to N * 2 * N * K nodes available at any given time
     size_t node_count;
@@ -133,6 +133,174 @@ CTEST(hazard_pointer, threaded)
     lockfree_ring_buffer_destroy(free_nodes);
 }
 
+//defined first so it runs last; the expedited membarrier() can't be unregistered. no other thread is running at this point, so switching modes is safe
+CTEST(hazard_pointer, asymmetric)
+{
+    printf("expedited membarrier: %d\n", asymmetric_barrier_init());
+    head = NULL;
+    run_threaded();
+    head = NULL;
+}
+
+CTEST(hazard_pointer, threaded)
+{
+    run_threaded();
+}
+
+int gc_count = 0;
+
+void count_node(void* user_data, hazard_node_t* node)
+{
+    (void) user_data;
+    (void) node;
+    ++gc_count;
+}
+
+CTEST(hazard_pointer, release_and_reuse)
+{
+    hazard_pointer_thread_record_t* list = NULL;
+    hazard_pointer_thread_record_t *one, *two, *three;
+    hazard_node_t node;
+
+    node.gc_data = NULL;
+    node.gc_function = &count_node;
+    gc_count = 0;
+
+    one = hazard_pointer_thread_record_create_and_push(&list, 2);
+    two = hazard_pointer_thread_record_create_and_push(&list, 2);
+    hazard_pointer_using(two, &node, 0);
+    hazard_pointer_free(one, &node);
+    //node is still hazardous, so it's left behind as an orphan
+    hazard_pointer_thread_record_release(one);
+    ASSERT_EQUAL(0, gc_count);
+    ASSERT_EQUAL_U(0, one->retired_count);
+    ASSERT_TRUE(one->orphans == &node);
+
+    //a new thread takes over the released record along with its orphans
+    three = hazard_pointer_thread_record_create_and_push(&list, 2);
+    ASSERT_TRUE(three == one);
+    ASSERT_NULL(three->orphans);
+    ASSERT_EQUAL_U(1, three->retired_count);
+    ASSERT_EQUAL_U(2 * 2 * 2, three->retire_threshold);
+
+    //released again; any other thread's scan adopts the orphan once it's no longer hazardous
+    hazard_pointer_thread_record_release(three);
+    hazard_pointer_done_using(two, 0);
+    hazard_pointer_scan(two);
+    ASSERT_EQUAL(1, gc_count);
+    ASSERT_NULL(one->orphans);
+    ASSERT_NULL(two->retired_list);
+    hazard_pointer_thread_record_destroy_all(list);
+
+    //orphans of the head record are freed by destroy_all(), which scans each record from itself
+    gc_count = 0;
+    list = NULL;
+    one = hazard_pointer_thread_record_create_and_push(&list, 2);
+    two = hazard_pointer_thread_record_create_and_push(&list, 2);
+    ASSERT_TRUE(list == two);
+    hazard_pointer_using(one, &node, 0);
+    hazard_pointer_free(two, &node);
+    hazard_pointer_thread_record_release(two);
+    ASSERT_TRUE(two->orphans == &node);
+    hazard_pointer_thread_record_destroy_all(list);
+    ASSERT_EQUAL(1, gc_count);
+
+    //destroy() of a record still in the list releases it instead of freeing it with a hazardous node
+    gc_count = 0;
+    list = NULL;
+    one = hazard_pointer_thread_record_create_and_push(&list, 2);
+    two = hazard_pointer_thread_record_create_and_push(&list, 2);
+    hazard_pointer_using(one, &node, 0);
+    hazard_pointer_free(two, &node);
+    hazard_pointer_thread_record_destroy(two);
+    ASSERT_TRUE(list == two);
+    ASSERT_FALSE(two->active);
+    ASSERT_TRUE(two->orphans == &node);
+    ASSERT_EQUAL(0, gc_count);
+    //and the next thread takes it over
+    ASSERT_TRUE(hazard_pointer_thread_record_create_and_push(&list, 2) == two);
+    hazard_pointer_done_using(one, 0);
+    hazard_pointer_scan(two);
+    ASSERT_EQUAL(1, gc_count);
+    hazard_pointer_thread_record_destroy_all(list);
+}
+
+#define CHURN_ROUNDS 200
+
+void* churn_function(void* param)
+{
+    size_t round, i;
+    (void) param;
+    pthread_barrier_wait(&barrier);
+    for(round = 0; round < CHURN_ROUNDS; ++round) {
+        hazard_pointer_thread_record_t* const my_record = hazard_pointer_thread_record_create_and_push(&head, POINTERS_PER_THREAD);
+        hazard_node_t* nodes[POINTERS_PER_THREAD];
+        for(i = 0; i < POINTERS_PER_THREAD; ++i) {
+            nodes[i] = get_node(my_record);
+            hazard_pointer_using(my_record, nodes[i], i);
+        }
+        for(i = 0; i < POINTERS_PER_THREAD; ++i) {
+            hazard_pointer_done_using(my_record, i);
+            hazard_pointer_free(my_record, nodes[i]);
+        }
+        hazard_pointer_thread_record_release(my_record);
+    }
+    return NULL;
+}
+
+CTEST(hazard_pointer, churn)
+{
+    const size_t BUFFER_SIZE = NUM_THREADS * 2 * NUM_THREADS * POINTERS_PER_THREAD;
+    size_t node_count;
+    pthread_t threads[NUM_THREADS];
+    intptr_t i;
+    size_t count = 0;
+    hazard_pointer_thread_record_t* cur;
+    hazard_pointer_thread_record_t* last;
+    void* to_free;
+
+    head = NULL;
+    free_nodes = lockfree_ring_buffer_create(10);
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    for(node_count = 0; node_count < BUFFER_SIZE; ++node_count) {
+        lockfree_ring_buffer_push(free_nodes, malloc(sizeof(hazard_node_t)));
+    }
+
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&threads[i], NULL, &churn_function, (void*)i);
+    }
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    //each thread holds at most one record at a time, so records are reused rather than piling up
+    cur = head;
+    while(cur) {
+        ASSERT_FALSE(cur->active);
+        cur = cur->next;
+        ++count;
+    }
+    ASSERT_TRUE(count <= NUM_THREADS);
+
+    //a scan from any record collects every orphan
+    last = hazard_pointer_thread_record_create_and_push(&head, POINTERS_PER_THREAD);
+    hazard_pointer_scan(last);
+    ASSERT_NULL(last->retired_list);
+    for(cur = head; cur; cur = cur->next) {
+        ASSERT_NULL(cur->orphans);
+    }
+
+    node_count = 0;
+    while((to_free = lockfree_ring_buffer_trypop(free_nodes))) {
+        free(to_free);
+        ++node_count;
+    }
+    ASSERT_EQUAL_U(BUFFER_SIZE, node_count);
+    hazard_pointer_thread_record_destroy_all(head);
+    head = NULL;
+    lockfree_ring_buffer_destroy(free_nodes);
+}
+
 int main(int argc, const char *argv[]) {
     return ctest_main(argc, argv);
 } /* main */
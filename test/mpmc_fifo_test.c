@@ -116,6 +116,84 @@ CTEST(mpmc_fifo, threaded)
     hazard_pointer_thread_record_destroy_all(hazard_head);
 }
 
+ebr_t ebr;
+
+void* push_func_ebr(void* p)
+{
+    intptr_t i;
+    reclaim_thread_t r = reclaim_thread_ebr(ebr_thread_record_create_and_push(&ebr));
+    (void) p;
+    pthread_barrier_wait(&barrier);
+    for(i = 1; i <= PUSH_COUNT; ++i) {
+        mpmc_fifo_node_t* const node = malloc(sizeof(mpmc_fifo_node_t));
+        node->value = (void*)i;
+        node->hazard.gc_data = NULL;
+        node->hazard.gc_function = &release_node;
+        mpmc_fifo_push_reclaim(&r, &fifo, node);
+    }
+    return NULL;
+}
+
+void* pop_func_ebr(void* p)
+{
+    intptr_t i;
+    reclaim_thread_t r = reclaim_thread_ebr(ebr_thread_record_create_and_push(&ebr));
+    (void) p;
+    pthread_barrier_wait(&barrier);
+    for(i = 1; i <= PUSH_COUNT; ++i) {
+        intptr_t value;
+        while(!(value = (intptr_t)mpmc_fifo_trypop_reclaim(&r, &fifo))) {};
+        ASSERT_TRUE(value > 0);
+        ASSERT_TRUE(value <= PUSH_COUNT);
+        __sync_fetch_and_add(&results[value - 1], 1);
+    }
+    return NULL;
+}
+
+CTEST(mpmc_fifo, threaded_ebr)
+{
+    intptr_t i = 0;
+    pthread_t producers[NUM_THREADS];
+    pthread_t consumers[NUM_THREADS];
+    reclaim_thread_t r;
+
+    mpmc_fifo_node_t* initial_node = (mpmc_fifo_node_t*)malloc(sizeof(mpmc_fifo_node_t));
+    initial_node->hazard.gc_function = &release_node;
+    initial_node->hazard.gc_data = NULL;
+    mpmc_fifo_init(&fifo, initial_node);
+    ebr_init(&ebr);
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS * 2);
+
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        results[i] = 0;
+    }
+
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&producers[i], NULL, &push_func_ebr, NULL);
+    }
+
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&consumers[i], NULL, &pop_func_ebr, NULL);
+    }
+
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+    }
+
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(consumers[i], 0);
+    }
+
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        ASSERT_EQUAL(NUM_THREADS, results[i]);
+    }
+
+    r = reclaim_thread_ebr(ebr_thread_record_create_and_push(&ebr));
+    mpmc_fifo_destroy_reclaim(&r, &fifo);
+    ebr_destroy(&ebr);
+}
+
 int main(int argc, const char *argv[]) {
     return ctest_main(argc, argv);
 } /* main */
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/mpmc_ring_queue.h>
+#include <fibconcurrent/lockfree_ring_buffer.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <sys/time.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+//compares mpmc_ring_queue against lockfree_ring_buffer with NUM_THREADS producers and NUM_THREADS consumers
+
+size_t NUM_THREADS = 2;
+size_t PER_THREAD_COUNT = 1000000;
+uint32_t LOG_SIZE = 10;
+pthread_barrier_t barrier;
+
+mpmc_ring_queue_t* q = NULL;
+lockfree_ring_buffer_t* rb = NULL;
+volatile long long checksum = 0;
+
+long long getusecs(struct timeval* tv)
+{
+    return (long long)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+void* q_push_function(void* param)
+{
+    size_t i;
+    (void) param;
+    pthread_barrier_wait(&barrier);
+    for(i = 1; i <= PER_THREAD_COUNT; ++i) {
+        while(mpmc_ring_queue_enqueue(q, (void*)i) != QERR_OK) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+void* q_pop_function(void* param)
+{
+    size_t i;
+    long long sum = 0;
+    (void) param;
+    pthread_barrier_wait(&barrier);
+    for(i = 1; i <= PER_THREAD_COUNT; ++i) {
+        void* d;
+        while(mpmc_ring_queue_dequeue(q, &d) != QERR_OK) {
+            sched_yield();
+        }
+        sum += (long long)(intptr_t)d;
+    }
+    __sync_add_and_fetch(&checksum, sum);
+    return NULL;
+}
+
+void* rb_push_function(void* param)
+{
+    size_t i;
+    (void) param;
+    pthread_barrier_wait(&barrier);
+    for(i = 1; i <= PER_THREAD_COUNT; ++i) {
+        while(!lockfree_ring_buffer_trypush(rb, (void*)i)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+void* rb_pop_function(void* param)
+{
+    size_t i;
+    long long sum = 0;
+    (void) param;
+    pthread_barrier_wait(&barrier);
+    for(i = 1; i <= PER_THREAD_COUNT; ++i) {
+        void* d;
+        while(!(d = lockfree_ring_buffer_trypop(rb))) {
+            sched_yield();
+        }
+        sum += (long long)(intptr_t)d;
+    }
+    __sync_add_and_fetch(&checksum, sum);
+    return NULL;
+}
+
+int run(const char* name, void* (*push_function)(void*), void* (*pop_function)(void*))
+{
+    size_t i;
+    pthread_t* threads;
+    struct timeval begin, end;
+    double us;
+    const long long expected = (long long)NUM_THREADS * (long long)PER_THREAD_COUNT * (long long)(PER_THREAD_COUNT + 1) / 2;
+
+    checksum = 0;
+    threads = malloc(2 * NUM_THREADS * sizeof(pthread_t));
+    pthread_barrier_init(&barrier, NULL, (unsigned int) (2 * NUM_THREADS + 1));
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&(threads[2 * i]), NULL, push_function, NULL);
+        pthread_create(&(threads[2 * i + 1]), NULL, pop_function, NULL);
+    }
+
+    gettimeofday(&begin, NULL);
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < 2 * NUM_THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    gettimeofday(&end, NULL);
+    pthread_barrier_destroy(&barrier);
+    free(threads);
+
+    us = (double) (getusecs(&end) - getusecs(&begin));
+    printf("%s: %lu producers %lu consumers %lu events %lf seconds (%.2f ns per item)\n",
+        name, NUM_THREADS, NUM_THREADS, PER_THREAD_COUNT, us / 1000000.0, us * 1000.0 / (double) (NUM_THREADS * PER_THREAD_COUNT));
+    if(checksum != expected) {
+        fprintf(stderr, "%s: checksum mismatch %lld != %lld\n", name, checksum, expected);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = 0;
+
+    if(argc > 1) {
+        NUM_THREADS = (size_t) atoi(argv[1]);
+    }
+    if(argc > 2) {
+        PER_THREAD_COUNT = (size_t) atoi(argv[2]);
+    }
+    if(argc > 3) {
+        LOG_SIZE = (uint32_t) atoi(argv[3]);
+    }
+
+    if(mpmc_ring_queue_create(&q, (size_t)1 << LOG_SIZE) != QERR_OK) {
+        fprintf(stderr, "unable to create mpmc_ring_queue\n");
+        return 1;
+    }
+    rb = lockfree_ring_buffer_create(LOG_SIZE);
+
+    ret |= run("mpmc_ring_queue", &q_push_function, &q_pop_function);
+    ret |= run("lockfree_ring_buffer", &rb_push_function, &rb_pop_function);
+
+    mpmc_ring_queue_destroy(q, NULL);
+    lockfree_ring_buffer_destroy(rb);
+    return ret;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/mpmc_ring_queue.h>
+#include <fibconcurrent/machine_specific.h>
+
+#include <stdint.h>
+#include <unistd.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PER_THREAD_COUNT 1000000
+#define NUM_THREADS 4
+
+mpmc_ring_queue_t* q;
+char counters[PER_THREAD_COUNT];
+pthread_barrier_t barrier;
+
+CTEST(mpmc_ring_queue, bad_size)
+{
+    mpmc_ring_queue_t* bad = (mpmc_ring_queue_t*)1;
+    ASSERT_EQUAL(QERR_BADSIZE, mpmc_ring_queue_create(&bad, 0));
+    ASSERT_NULL(bad);
+    ASSERT_EQUAL(QERR_BADSIZE, mpmc_ring_queue_create(&bad, 1));
+    ASSERT_EQUAL(QERR_BADSIZE, mpmc_ring_queue_create(&bad, 100));
+}
+
+CTEST(mpmc_ring_queue, full_empty)
+{
+    mpmc_ring_queue_t* small;
+    intptr_t i;
+    int lap;
+    void* d;
+
+    ASSERT_EQUAL(QERR_OK, mpmc_ring_queue_create(&small, 8));
+    ASSERT_EQUAL_U(8, mpmc_ring_queue_capacity(small));
+    for(lap = 0; lap < 3; ++lap) {
+        ASSERT_EQUAL(QERR_EMPTY, mpmc_ring_queue_dequeue(small, &d));
+        for(i = 0; i < 8; ++i) {
+            //NULL is a valid message
+            ASSERT_EQUAL(QERR_OK, mpmc_ring_queue_enqueue(small, (void*)i));
+        }
+        ASSERT_EQUAL_U(8, mpmc_ring_queue_len(small));
+        ASSERT_EQUAL(QERR_FULL, mpmc_ring_queue_enqueue(small, (void*)i));
+        for(i = 0; i < 8; ++i) {
+            ASSERT_EQUAL(QERR_OK, mpmc_ring_queue_dequeue(small, &d));
+            ASSERT_EQUAL(i, (intptr_t)d);
+        }
+        ASSERT_EQUAL_U(0, mpmc_ring_queue_len(small));
+    }
+    mpmc_ring_queue_destroy(small, NULL);
+}
+
+CTEST(mpmc_ring_queue, destroy_frees)
+{
+    mpmc_ring_queue_t* small;
+    ASSERT_EQUAL(QERR_OK, mpmc_ring_queue_create(&small, 4));
+    ASSERT_EQUAL(QERR_OK, mpmc_ring_queue_enqueue(small, malloc(16)));
+    ASSERT_EQUAL(QERR_OK, mpmc_ring_queue_enqueue(small, malloc(16)));
+    mpmc_ring_queue_destroy(small, &free);
+}
+
+void* run_function(void* param)
+{
+    intptr_t i;
+
+    (void) param;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PER_THREAD_COUNT; ++i) {
+        void* d;
+        intptr_t j;
+        while(mpmc_ring_queue_enqueue(q, (void*)i) != QERR_OK) {
+            cpu_relax();
+        }
+        ASSERT_TRUE(mpmc_ring_queue_len(q) <= 128);
+        while(mpmc_ring_queue_dequeue(q, &d) != QERR_OK) {
+            cpu_relax();
+        }
+        j = (intptr_t)d;
+        ASSERT_TRUE(j >= 0 && j < PER_THREAD_COUNT);
+        __sync_add_and_fetch(&counters[j], 1);
+    }
+    return NULL;
+}
+
+CTEST(mpmc_ring_queue, threaded)
+{
+    pthread_t threads[NUM_THREADS];
+    int i;
+
+    ASSERT_EQUAL(QERR_OK, mpmc_ring_queue_create(&q, 128));
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+
+    for(i = 0; i < PER_THREAD_COUNT; ++i) {
+        counters[i] = 0;
+    }
+
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&threads[i], NULL, &run_function, NULL);
+    }
+
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    mpmc_ring_queue_destroy(q, NULL);
+
+    for(i = 0; i < PER_THREAD_COUNT; ++i) {
+        ASSERT_EQUAL(NUM_THREADS, counters[i]);
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    return ctest_main(argc, argv);
+} /* main */
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/mpsc_bounded_fifo.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 1000000
+#define NUM_THREADS 4
+#define CAPACITY 256
+#define BATCH 16
+
+mpsc_bounded_fifo_t fifo;
+int results[PUSH_COUNT];
+pthread_barrier_t barrier;
+
+void* push_func(void* p)
+{
+    const size_t shard = (size_t)(intptr_t)p;
+    intptr_t i;
+
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        mpsc_bounded_fifo_node_t* const node = malloc(sizeof(mpsc_bounded_fifo_node_t));
+        node->data = (void*)i;
+        //try_push() and sched_yield() rather than push() so the consumer gets the cpu on small machines
+        while(!mpsc_bounded_fifo_try_push(&fifo, shard, node)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+CTEST(mpsc_bounded_fifo, credits)
+{
+    mpsc_bounded_fifo_node_t* nodes[CAPACITY];
+    mpsc_bounded_fifo_node_t* node;
+    mpsc_bounded_fifo_node_t extra;
+    intptr_t i;
+
+    ASSERT_TRUE(mpsc_bounded_fifo_init(&fifo, CAPACITY, 4, BATCH));
+    ASSERT_EQUAL(CAPACITY, mpsc_bounded_fifo_capacity(&fifo));
+    //shard 0 only has its share of the capacity
+    for(i = 0; i < CAPACITY / 4; ++i) {
+        nodes[i] = malloc(sizeof(mpsc_bounded_fifo_node_t));
+        nodes[i]->data = (void*)i;
+        ASSERT_TRUE(mpsc_bounded_fifo_try_push(&fifo, 0, nodes[i]));
+    }
+    ASSERT_FALSE(mpsc_bounded_fifo_try_push(&fifo, 0, &extra));
+    //shard 5 maps to shard 1, which still has credits
+    nodes[i] = malloc(sizeof(mpsc_bounded_fifo_node_t));
+    nodes[i]->data = (void*)i;
+    ASSERT_TRUE(mpsc_bounded_fifo_try_push(&fifo, 5, nodes[i]));
+
+    //credits come back one batch at a time
+    for(i = 0; i < BATCH - 1; ++i) {
+        node = mpsc_bounded_fifo_trypop(&fifo);
+        ASSERT_EQUAL(i, (intptr_t)node->data);
+        ASSERT_EQUAL(0, node->shard);
+        free(node);
+    }
+    ASSERT_FALSE(mpsc_bounded_fifo_try_push(&fifo, 0, &extra));
+    node = mpsc_bounded_fifo_trypop(&fifo);
+    free(node);
+    ASSERT_EQUAL(BATCH, fifo.shards[0].credits);
+
+    //and all at once when the FIFO is empty
+    while((node = mpsc_bounded_fifo_trypop(&fifo))) {
+        free(node);
+    }
+    ASSERT_EQUAL(CAPACITY / 4, fifo.shards[0].credits);
+    ASSERT_EQUAL(CAPACITY / 4, fifo.shards[1].credits);
+    mpsc_bounded_fifo_destroy(&fifo);
+}
+
+CTEST(mpsc_bounded_fifo, threaded)
+{
+    pthread_t producers[NUM_THREADS];
+    intptr_t i = 0;
+    mpsc_bounded_fifo_node_t* node = NULL;
+    int64_t credits;
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    ASSERT_TRUE(mpsc_bounded_fifo_init(&fifo, CAPACITY, NUM_THREADS - 1, BATCH));
+
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        results[i] = 0;
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_create(&producers[i], NULL, &push_func, (void*)(i - 1));
+    }
+
+    pthread_barrier_wait(&barrier);
+
+    for(i = 0; i < PUSH_COUNT * (NUM_THREADS-1); ++i) {
+        while(!(node = mpsc_bounded_fifo_trypop(&fifo))) {
+            sched_yield();
+        }
+        ++results[(intptr_t)node->data];
+        free(node);
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+    }
+
+    ASSERT_NULL(mpsc_bounded_fifo_trypop(&fifo));
+    credits = 0;
+    for(i = 0; i < NUM_THREADS - 1; ++i) {
+        ASSERT_TRUE(fifo.shards[i].credits > 0);
+        credits += fifo.shards[i].credits;
+    }
+    ASSERT_EQUAL(CAPACITY, credits);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        ASSERT_EQUAL(NUM_THREADS - 1, results[i]);
+    }
+
+    mpsc_bounded_fifo_destroy(&fifo);
+    pthread_barrier_destroy(&barrier);
+}
+
+int main(int argc, const char *argv[]) {
+    return ctest_main(argc, argv);
+} /* main */
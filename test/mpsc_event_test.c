@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/mpsc_event_fifo.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 1000000
+#define BURST_SIZE 1000
+#define NUM_THREADS 4
+
+mpsc_event_fifo_t fifo;
+int results[PUSH_COUNT];
+pthread_barrier_t barrier;
+
+static int readable(int fd, int timeout_ms)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, timeout_ms) == 1 && (pfd.revents & POLLIN);
+}
+
+void* push_func(void* p)
+{
+    intptr_t i;
+
+    (void) p;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        mpsc_fifo_node_t* const node = malloc(sizeof(mpsc_fifo_node_t));
+        node->data = (void*)i;
+        mpsc_event_fifo_push(&fifo, node);
+        if(i % BURST_SIZE == 0) {
+            //let the consumer drain and go back to poll()
+            usleep(10);
+        }
+    }
+    return NULL;
+}
+
+CTEST(mpsc_event_fifo, one_signal_per_burst)
+{
+    intptr_t i;
+    mpsc_fifo_node_t* node;
+
+    ASSERT_TRUE(mpsc_event_fifo_init(&fifo));
+    ASSERT_FALSE(readable(mpsc_event_fifo_fd(&fifo), 0));
+
+    for(i = 0; i < BURST_SIZE; ++i) {
+        node = malloc(sizeof(mpsc_fifo_node_t));
+        node->data = (void*)i;
+        mpsc_event_fifo_push(&fifo, node);
+    }
+    ASSERT_TRUE(readable(mpsc_event_fifo_fd(&fifo), 0));
+#if HAVE_EVENTFD
+    {
+        //only the first push of the burst wrote to the eventfd
+        uint64_t count = 0;
+        ASSERT_EQUAL(sizeof(count), read(mpsc_event_fifo_fd(&fifo), &count, sizeof(count)));
+        ASSERT_EQUAL(1, count);
+        mpsc_event_fifo_signal(&fifo);
+    }
+#endif
+
+    mpsc_event_fifo_rearm(&fifo);
+    ASSERT_FALSE(readable(mpsc_event_fifo_fd(&fifo), 0));
+    for(i = 0; i < BURST_SIZE; ++i) {
+        node = mpsc_event_fifo_trypop(&fifo);
+        ASSERT_NOT_NULL(node);
+        ASSERT_EQUAL(i, (intptr_t)node->data);
+        free(node);
+    }
+    ASSERT_NULL(mpsc_event_fifo_trypop(&fifo));
+
+    //the next push signals again
+    node = malloc(sizeof(mpsc_fifo_node_t));
+    mpsc_event_fifo_push(&fifo, node);
+    ASSERT_TRUE(readable(mpsc_event_fifo_fd(&fifo), 0));
+    mpsc_event_fifo_destroy(&fifo);
+}
+
+CTEST(mpsc_event_fifo, threaded)
+{
+    pthread_t producers[NUM_THREADS];
+    intptr_t i = 0;
+    intptr_t popped = 0;
+    size_t wakeups = 0;
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    ASSERT_TRUE(mpsc_event_fifo_init(&fifo));
+
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        results[i] = 0;
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_create(&producers[i], NULL, &push_func, NULL);
+    }
+
+    pthread_barrier_wait(&barrier);
+
+    while(popped < PUSH_COUNT * (NUM_THREADS-1)) {
+        mpsc_fifo_node_t* node;
+        //a lost wakeup shows up as a timeout here
+        ASSERT_TRUE(readable(mpsc_event_fifo_fd(&fifo), 5000));
+        ++wakeups;
+        mpsc_event_fifo_rearm(&fifo);
+        while((node = mpsc_event_fifo_trypop(&fifo))) {
+            ++results[(intptr_t)node->data];
+            free(node);
+            ++popped;
+        }
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+    }
+
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        ASSERT_EQUAL(NUM_THREADS - 1, results[i]);
+    }
+    printf("%zu wakeups for %ld items\n", wakeups, (long)popped);
+
+    mpsc_event_fifo_destroy(&fifo);
+    pthread_barrier_destroy(&barrier);
+}
+
+int main(int argc, const char *argv[]) {
+    return ctest_main(argc, argv);
+} /* main */
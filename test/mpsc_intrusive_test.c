@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/mpsc_intrusive_fifo.h>
+#include <fibconcurrent/machine_specific.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 1000000
+#define NUM_THREADS 4
+
+typedef struct message
+{
+    intptr_t producer;
+    intptr_t seq;
+    mpsc_intrusive_node_t node;//deliberately not the first member
+} message_t;
+
+mpsc_intrusive_fifo_t fifo;
+pthread_barrier_t barrier;
+message_t* messages[NUM_THREADS];
+
+void* push_func(void* p)
+{
+    const intptr_t producer = (intptr_t)p;
+    intptr_t i;
+
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        message_t* const msg = &messages[producer][i];
+        msg->producer = producer;
+        msg->seq = i;
+        mpsc_intrusive_fifo_push(&fifo, &msg->node);
+    }
+    return NULL;
+}
+
+CTEST(mpsc_intrusive_fifo, single_thread)
+{
+    message_t msgs[3];
+    mpsc_intrusive_node_t* node;
+    int round, i;
+
+    mpsc_intrusive_fifo_init(&fifo);
+    ASSERT_TRUE(MPSC_INTRUSIVE_EMPTY == mpsc_intrusive_fifo_trypop(&fifo));
+    //the stub is re-pushed whenever the last node is popped
+    for(round = 0; round < 3; ++round) {
+        for(i = 0; i <= round; ++i) {
+            msgs[i].seq = i;
+            mpsc_intrusive_fifo_push(&fifo, &msgs[i].node);
+        }
+        for(i = 0; i <= round; ++i) {
+            node = mpsc_intrusive_fifo_trypop(&fifo);
+            ASSERT_TRUE(node == &msgs[i].node);
+            ASSERT_EQUAL(i, mpsc_intrusive_fifo_entry(node, message_t, node)->seq);
+        }
+        ASSERT_TRUE(MPSC_INTRUSIVE_EMPTY == mpsc_intrusive_fifo_trypop(&fifo));
+    }
+}
+
+CTEST(mpsc_intrusive_fifo, retry)
+{
+    message_t a, b;
+    mpsc_intrusive_node_t* prev_tail;
+
+    mpsc_intrusive_fifo_init(&fifo);
+    mpsc_intrusive_fifo_push(&fifo, &a.node);
+    //simulate a producer which swapped tail but didn't link its node yet
+    b.node.next = NULL;
+    prev_tail = fifo.tail;
+    fifo.tail = &b.node;
+    ASSERT_TRUE(MPSC_INTRUSIVE_RETRY == mpsc_intrusive_fifo_trypop(&fifo));
+    prev_tail->next = &b.node;
+    ASSERT_TRUE(&a.node == mpsc_intrusive_fifo_trypop(&fifo));
+    ASSERT_TRUE(&b.node == mpsc_intrusive_fifo_trypop(&fifo));
+    ASSERT_TRUE(MPSC_INTRUSIVE_EMPTY == mpsc_intrusive_fifo_trypop(&fifo));
+}
+
+CTEST(mpsc_intrusive_fifo, threaded)
+{
+    pthread_t producers[NUM_THREADS];
+    intptr_t next[NUM_THREADS];
+    intptr_t i = 0;
+    size_t retries = 0;
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    mpsc_intrusive_fifo_init(&fifo);
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        next[i] = 0;
+        messages[i] = malloc(PUSH_COUNT * sizeof(message_t));
+        pthread_create(&producers[i], NULL, &push_func, (void*)i);
+    }
+
+    pthread_barrier_wait(&barrier);
+
+    for(i = 0; i < PUSH_COUNT * (NUM_THREADS-1); ++i) {
+        mpsc_intrusive_node_t* node;
+        message_t* msg;
+        while(1) {
+            node = mpsc_intrusive_fifo_trypop(&fifo);
+            if(node == MPSC_INTRUSIVE_RETRY) {
+                ++retries;
+                cpu_relax();
+            } else if(node != MPSC_INTRUSIVE_EMPTY) {
+                break;
+            }
+        }
+        msg = mpsc_intrusive_fifo_entry(node, message_t, node);
+        ASSERT_TRUE(msg->producer > 0 && msg->producer < NUM_THREADS);
+        //the pushed object itself comes back, in order per producer
+        ASSERT_TRUE(msg == &messages[msg->producer][next[msg->producer]]);
+        ASSERT_EQUAL(next[msg->producer], msg->seq);
+        ++next[msg->producer];
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+        ASSERT_EQUAL(PUSH_COUNT, next[i]);
+        free(messages[i]);
+    }
+    ASSERT_TRUE(MPSC_INTRUSIVE_EMPTY == mpsc_intrusive_fifo_trypop(&fifo));
+    printf("retries: %zu\n", retries);
+}
+
+int main(int argc, const char *argv[]) {
+    return ctest_main(argc, argv);
+} /* main */
@@ -90,6 +90,75 @@ CTEST(mpsc_fifo, threaded)
     mpsc_fifo_destroy(&fifo);
 }
 
+#define CHAIN_LENGTH 32
+
+void* push_chain_func(void* p)
+{
+    intptr_t i, j;
+
+    (void) p;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; i += CHAIN_LENGTH) {
+        mpsc_fifo_node_t* first = NULL;
+        mpsc_fifo_node_t* last = NULL;
+        for(j = i; j < i + CHAIN_LENGTH && j < PUSH_COUNT; ++j) {
+            mpsc_fifo_node_t* const node = malloc(sizeof(mpsc_fifo_node_t));
+            node->data = (void*)j;
+            if(last) {
+                last->next = node;
+            } else {
+                first = node;
+            }
+            last = node;
+        }
+        mpsc_fifo_push_chain(&fifo, first, last);
+    }
+    return NULL;
+}
+
+CTEST(mpsc_fifo, batched)
+{
+    pthread_t producers[NUM_THREADS];
+    mpsc_fifo_node_t* nodes[CHAIN_LENGTH];
+    intptr_t i = 0;
+    size_t popped = 0;
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    mpsc_fifo_init(&fifo);
+
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        results[i] = 0;
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_create(&producers[i], NULL, &push_chain_func, NULL);
+    }
+
+    pthread_barrier_wait(&barrier);
+
+    while(popped < (size_t)PUSH_COUNT * (NUM_THREADS-1)) {
+        const size_t count = mpsc_fifo_pop_many(&fifo, nodes, CHAIN_LENGTH);
+        size_t j;
+        for(j = 0; j < count; ++j) {
+            ++results[(intptr_t)nodes[j]->data];
+            free(nodes[j]);
+        }
+        popped += count;
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+    }
+
+    ASSERT_EQUAL(0, mpsc_fifo_pop_many(&fifo, nodes, CHAIN_LENGTH));
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        ASSERT_EQUAL(NUM_THREADS - 1, results[i]);
+    }
+
+    printf("cleaning...\n");
+    mpsc_fifo_destroy(&fifo);
+}
+
 int main(int argc, const char *argv[]) {
     return ctest_main(argc, argv);
 } /* main */
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/mpsc_ticket_queue.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/time.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 1000000
+#define NUM_THREADS 4
+#define THREAD_SHIFT 32
+#define LOG_SIZE 10
+#define BATCH 64
+
+mpsc_ticket_queue_t* q = NULL;
+pthread_barrier_t barrier;
+
+long long getusecs(struct timeval* tv)
+{
+    return (long long)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+void* push_func(void* p)
+{
+    const intptr_t thread = (intptr_t)p;
+    intptr_t i;
+
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        while(!mpsc_ticket_queue_trypush(q, (void*)((thread << THREAD_SHIFT) | i))) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+CTEST(mpsc_ticket_queue, full_empty)
+{
+    void* out[4];
+    intptr_t i;
+
+    q = mpsc_ticket_queue_create(2);
+    ASSERT_NOT_NULL(q);
+    ASSERT_FALSE(mpsc_ticket_queue_trypop(q, out));
+    for(i = 0; i < 4; ++i) {
+        ASSERT_TRUE(mpsc_ticket_queue_trypush(q, (void*)i));
+    }
+    ASSERT_FALSE(mpsc_ticket_queue_trypush(q, (void*)i));
+    ASSERT_EQUAL(4, mpsc_ticket_queue_size(q));
+
+    ASSERT_TRUE(mpsc_ticket_queue_trypop(q, out));
+    ASSERT_TRUE(out[0] == (void*)0);
+    //the next lap of slot 0
+    mpsc_ticket_queue_push(q, (void*)4);
+    ASSERT_EQUAL(4, mpsc_ticket_queue_pop_n(q, out, 4));
+    for(i = 0; i < 4; ++i) {
+        ASSERT_TRUE(out[i] == (void*)(i + 1));
+    }
+    ASSERT_EQUAL(0, mpsc_ticket_queue_pop_n(q, out, 4));
+    ASSERT_EQUAL(0, mpsc_ticket_queue_size(q));
+    mpsc_ticket_queue_destroy(q);
+}
+
+#define STALLED_ATTEMPTS 10000
+
+int stalled_successes = 0;
+
+void* trypush_stalled_func(void* p)
+{
+    intptr_t i;
+    (void)p;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < STALLED_ATTEMPTS; ++i) {
+        if(mpsc_ticket_queue_trypush(q, (void*)i)) {
+            __sync_fetch_and_add(&stalled_successes, 1);
+        }
+    }
+    return NULL;
+}
+
+CTEST(mpsc_ticket_queue, trypush_stalled_consumer)
+{
+    pthread_t producers[NUM_THREADS];
+    intptr_t i;
+
+    //with no consumer running, racing try_push() calls must fill the queue exactly and never block
+    stalled_successes = 0;
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    q = mpsc_ticket_queue_create(2);
+    ASSERT_NOT_NULL(q);
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&producers[i], NULL, &trypush_stalled_func, NULL);
+    }
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+    }
+    ASSERT_EQUAL(4, stalled_successes);
+    ASSERT_EQUAL(4, mpsc_ticket_queue_size(q));
+    pthread_barrier_destroy(&barrier);
+    mpsc_ticket_queue_destroy(q);
+}
+
+CTEST(mpsc_ticket_queue, threaded)
+{
+    pthread_t producers[NUM_THREADS];
+    intptr_t next[NUM_THREADS];
+    void* out[BATCH];
+    struct timeval begin, end;
+    intptr_t i = 0;
+    intptr_t popped = 0;
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    q = mpsc_ticket_queue_create(LOG_SIZE);
+    ASSERT_NOT_NULL(q);
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        next[i] = 0;
+        pthread_create(&producers[i], NULL, &push_func, (void*)i);
+    }
+
+    pthread_barrier_wait(&barrier);
+    gettimeofday(&begin, NULL);
+
+    while(popped < PUSH_COUNT * (NUM_THREADS-1)) {
+        const size_t count = mpsc_ticket_queue_pop_n(q, out, BATCH);
+        size_t j;
+        if(!count) {
+            sched_yield();
+            continue;
+        }
+        for(j = 0; j < count; ++j) {
+            const intptr_t thread = (intptr_t)out[j] >> THREAD_SHIFT;
+            ASSERT_TRUE(thread > 0 && thread < NUM_THREADS);
+            //items from one producer come out in the order they were pushed
+            ASSERT_EQUAL(next[thread], (intptr_t)out[j] & ((1LL << THREAD_SHIFT) - 1));
+            ++next[thread];
+        }
+        popped += count;
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+        ASSERT_EQUAL(PUSH_COUNT, next[i]);
+    }
+    gettimeofday(&end, NULL);
+    printf("%d items in %lld us\n", PUSH_COUNT * (NUM_THREADS-1), getusecs(&end) - getusecs(&begin));
+
+    mpsc_ticket_queue_destroy(q);
+    pthread_barrier_destroy(&barrier);
+}
+
+int main(int argc, const char *argv[]) {
+    return ctest_main(argc, argv);
+} /* main */
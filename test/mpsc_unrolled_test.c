@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/mpsc_unrolled_fifo.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 2000000
+#define NUM_THREADS 4
+#define THREAD_SHIFT 32
+
+mpsc_unrolled_fifo_t fifo;
+pthread_barrier_t barrier;
+
+long long getusecs(struct timeval* tv)
+{
+    return (long long)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+void* push_func(void* p)
+{
+    const intptr_t thread = (intptr_t)p;
+    intptr_t i;
+
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        mpsc_unrolled_fifo_push(&fifo, (void*)((thread << THREAD_SHIFT) | i));
+    }
+    return NULL;
+}
+
+CTEST(mpsc_unrolled_fifo, segment_boundaries)
+{
+    intptr_t i, round;
+    void* data = NULL;
+
+    ASSERT_TRUE(mpsc_unrolled_fifo_init(&fifo));
+    ASSERT_FALSE(mpsc_unrolled_fifo_trypop(&fifo, &data));
+    for(round = 0; round < 4; ++round) {
+        for(i = 0; i < UNROLLED_FIFO_SEGMENT_SIZE * 3 + 1; ++i) {
+            ASSERT_TRUE(mpsc_unrolled_fifo_push(&fifo, (void*)i));
+        }
+        for(i = 0; i < UNROLLED_FIFO_SEGMENT_SIZE * 3 + 1; ++i) {
+            ASSERT_TRUE(mpsc_unrolled_fifo_trypop(&fifo, &data));
+            ASSERT_EQUAL(i, (intptr_t)data);
+        }
+        ASSERT_FALSE(mpsc_unrolled_fifo_trypop(&fifo, &data));
+    }
+    mpsc_unrolled_fifo_destroy(&fifo);
+}
+
+CTEST(mpsc_unrolled_fifo, threaded)
+{
+    pthread_t producers[NUM_THREADS];
+    intptr_t next[NUM_THREADS];
+    struct timeval begin;
+    struct timeval end;
+    intptr_t i = 0;
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    ASSERT_TRUE(mpsc_unrolled_fifo_init(&fifo));
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        next[i] = 0;
+        pthread_create(&producers[i], NULL, &push_func, (void*)i);
+    }
+
+    pthread_barrier_wait(&barrier);
+    gettimeofday(&begin, NULL);
+
+    for(i = 0; i < PUSH_COUNT * (NUM_THREADS-1); ++i) {
+        void* data = NULL;
+        intptr_t thread;
+        while(!mpsc_unrolled_fifo_trypop(&fifo, &data)) {};
+        thread = (intptr_t)data >> THREAD_SHIFT;
+        ASSERT_TRUE(thread > 0 && thread < NUM_THREADS);
+        //items from one producer come out in the order they were pushed
+        ASSERT_EQUAL(next[thread], (intptr_t)data & ((1LL << THREAD_SHIFT) - 1));
+        ++next[thread];
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+    }
+    gettimeofday(&end, NULL);
+    printf("unrolled (%d slots per segment): %d items in %lld us\n",
+           UNROLLED_FIFO_SEGMENT_SIZE, PUSH_COUNT * (NUM_THREADS-1), getusecs(&end) - getusecs(&begin));
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        ASSERT_EQUAL(PUSH_COUNT, next[i]);
+    }
+
+    printf("cleaning...\n");
+    mpsc_unrolled_fifo_destroy(&fifo);
+    pthread_barrier_destroy(&barrier);
+}
+
+int main(int argc, const char *argv[]) {
+    return ctest_main(argc, argv);
+} /* main */
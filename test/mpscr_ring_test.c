@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/mpsc_relaxed_ring.h>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 1000000
+#define NUM_THREADS 4
+#define THREAD_SHIFT 32
+#define LOG_SIZE 6
+
+mpscr_ring_t* ring = NULL;
+pthread_barrier_t barrier;
+
+void* push_func(void* p)
+{
+    const intptr_t thread_id = (intptr_t)p;
+    intptr_t i;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        void* const data = (void*)((thread_id << THREAD_SHIFT) | i);
+        if(ring->policy == MPSCR_RING_FAIL) {
+            while(!mpscr_ring_push(ring, (size_t)thread_id, data)) {
+                sched_yield();
+            }
+        } else {
+            mpscr_ring_push(ring, (size_t)thread_id, data);
+        }
+    }
+    return NULL;
+}
+
+static void run_threaded(int policy)
+{
+    intptr_t i = 0;
+    pthread_t producers[NUM_THREADS];
+    intptr_t next[NUM_THREADS];
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    ring = mpscr_ring_create(NUM_THREADS-1, LOG_SIZE, policy);
+    ASSERT_NOT_NULL(ring);
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        next[i-1] = 0;
+        pthread_create(&producers[i], NULL, &push_func, (void*)(i-1));
+    }
+
+    pthread_barrier_wait(&barrier);
+
+    for(i = 0; i < PUSH_COUNT * (NUM_THREADS-1); ++i) {
+        void* data = NULL;
+        intptr_t thread;
+        while(!mpscr_ring_trypop(ring, &data)) {
+            sched_yield();
+        }
+        thread = (intptr_t)data >> THREAD_SHIFT;
+        ASSERT_TRUE(thread >= 0 && thread < NUM_THREADS - 1);
+        //per-producer FIFO, also across the ring and the spill list
+        ASSERT_EQUAL(next[thread], (intptr_t)data & ((1LL << THREAD_SHIFT) - 1));
+        ++next[thread];
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+    }
+
+    mpscr_ring_destroy(ring);
+    pthread_barrier_destroy(&barrier);
+}
+
+CTEST(mpscr_ring, fail)
+{
+    void* data = NULL;
+    intptr_t i;
+
+    ring = mpscr_ring_create(2, 2, MPSCR_RING_FAIL);
+    ASSERT_NOT_NULL(ring);
+    ASSERT_TRUE((uintptr_t)mpscr_ring_lane(ring, 1) % CACHE_LINE_SIZE == 0);
+    ASSERT_FALSE(mpscr_ring_trypop(ring, &data));
+    for(i = 0; i < 4; ++i) {
+        ASSERT_TRUE(mpscr_ring_push(ring, 1, (void*)i));
+    }
+    ASSERT_FALSE(mpscr_ring_push(ring, 1, (void*)i));
+    ASSERT_TRUE(mpscr_ring_push(ring, 0, (void*)100));
+    //round robin across the lanes
+    ASSERT_TRUE(mpscr_ring_trypop(ring, &data) && data == (void*)100);
+    for(i = 0; i < 4; ++i) {
+        ASSERT_TRUE(mpscr_ring_trypop(ring, &data));
+        ASSERT_TRUE(data == (void*)i);
+    }
+    ASSERT_FALSE(mpscr_ring_trypop(ring, &data));
+    mpscr_ring_destroy(ring);
+}
+
+CTEST(mpscr_ring, spill)
+{
+    void* data = NULL;
+    intptr_t i;
+
+    ring = mpscr_ring_create(1, 2, MPSCR_RING_SPILL);
+    ASSERT_NOT_NULL(ring);
+    for(i = 0; i < 6; ++i) {
+        ASSERT_TRUE(mpscr_ring_push(ring, 0, (void*)i));
+    }
+    ASSERT_EQUAL(2, mpscr_ring_lane(ring, 0)->spilled);
+    //the ring has room again, but the producer keeps spilling until the spill list is drained
+    ASSERT_TRUE(mpscr_ring_trypop(ring, &data) && data == (void*)0);
+    ASSERT_TRUE(mpscr_ring_push(ring, 0, (void*)6));
+    ASSERT_EQUAL(3, mpscr_ring_lane(ring, 0)->spilled);
+    for(i = 1; i < 7; ++i) {
+        ASSERT_TRUE(mpscr_ring_trypop(ring, &data));
+        ASSERT_TRUE(data == (void*)i);
+    }
+    ASSERT_FALSE(mpscr_ring_trypop(ring, &data));
+    ASSERT_TRUE(mpscr_ring_push(ring, 0, (void*)7));
+    ASSERT_EQUAL(3, mpscr_ring_lane(ring, 0)->spilled);
+    ASSERT_TRUE(mpscr_ring_trypop(ring, &data) && data == (void*)7);
+    mpscr_ring_destroy(ring);
+}
+
+CTEST(mpscr_ring, threaded_fail)
+{
+    run_threaded(MPSCR_RING_FAIL);
+}
+
+CTEST(mpscr_ring, threaded_spill)
+{
+    run_threaded(MPSCR_RING_SPILL);
+}
+
+int main(int argc, const char *argv[]) {
+    return ctest_main(argc, argv);
+} /* main */
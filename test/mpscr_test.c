@@ -18,6 +18,7 @@
 
 #include <stdint.h>
 #include <unistd.h>
+#include <sched.h>
 
 #include <pthread.h>
 #if !HAVE_PTHREAD_BARRIER
@@ -87,6 +88,344 @@ CTEST(mpscr_fifo, threaded)
     mpscr_fifo_destroy(fifo);
 }
 
+#define DYNAMIC_LANES 2
+#define DYNAMIC_ROUNDS 100
+#define DYNAMIC_ROUND_COUNT 10000
+
+void* dynamic_push_func(void* p)
+{
+    intptr_t round, i;
+    (void) p;
+    pthread_barrier_wait(&barrier);
+    for(round = 0; round < DYNAMIC_ROUNDS; ++round) {
+        //producers come and go, and share fewer lanes than there are producers
+        size_t lane;
+        while((lane = mpscr_fifo_register(fifo)) == MPSCR_FIFO_NO_LANE) {
+            usleep(1);
+        }
+        for(i = 0; i < DYNAMIC_ROUND_COUNT; ++i) {
+            spsc_node_t* const node = malloc(sizeof(spsc_node_t));
+            node->data = (void*)(round * DYNAMIC_ROUND_COUNT + i);
+            mpscr_fifo_push(fifo, lane, node);
+        }
+        mpscr_fifo_deregister(fifo, lane);
+    }
+    return NULL;
+}
+
+void* drain_push_func(void* p)
+{
+    intptr_t thread_id = (intptr_t)p;
+    intptr_t i;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < DYNAMIC_ROUND_COUNT * DYNAMIC_ROUNDS; ++i) {
+        spsc_node_t* const node = malloc(sizeof(spsc_node_t));
+        node->data = (void*)i;
+        mpscr_fifo_push(fifo, (size_t) thread_id, node);
+    }
+    return NULL;
+}
+
+CTEST(mpscr_fifo, register)
+{
+    size_t lane0, lane1;
+    spsc_node_t* node = NULL;
+
+    fifo = mpscr_fifo_create_ex(2, MPSCR_FIFO_DYNAMIC);
+    ASSERT_NOT_NULL(fifo);
+    ASSERT_NULL(mpscr_fifo_trypop(fifo));
+
+    lane0 = mpscr_fifo_register(fifo);
+    lane1 = mpscr_fifo_register(fifo);
+    ASSERT_TRUE(lane0 != lane1);
+    ASSERT_EQUAL(MPSCR_FIFO_NO_LANE, mpscr_fifo_register(fifo));
+
+    node = malloc(sizeof(spsc_node_t));
+    node->data = (void*)1;
+    mpscr_fifo_push(fifo, lane0, node);
+    mpscr_fifo_deregister(fifo, lane0);
+    ASSERT_EQUAL(MPSCR_FIFO_NO_LANE, mpscr_fifo_register(fifo));
+
+    //a deregistered lane is drained before it's recycled
+    node = mpscr_fifo_trypop(fifo);
+    ASSERT_NOT_NULL(node);
+    ASSERT_TRUE(node->data == (void*)1);
+    free(node);
+    ASSERT_NULL(mpscr_fifo_trypop(fifo));
+    ASSERT_EQUAL(lane0, mpscr_fifo_register(fifo));
+
+    mpscr_fifo_destroy(fifo);
+}
+
+CTEST(mpscr_fifo, summary)
+{
+    const size_t num_lanes = 130;
+    const size_t lanes[] = {129, 3, 64, 65};
+    spsc_node_t* node = NULL;
+    size_t i;
+
+    fifo = mpscr_fifo_create(num_lanes);
+    ASSERT_NOT_NULL(fifo);
+    ASSERT_NULL(mpscr_fifo_trypop(fifo));
+    for(i = 0; i < sizeof(lanes) / sizeof(lanes[0]); ++i) {
+        node = malloc(sizeof(spsc_node_t));
+        node->data = (void*)lanes[i];
+        mpscr_fifo_push(fifo, lanes[i], node);
+        ASSERT_TRUE(mpscr_fifo_summary_test(fifo, lanes[i]));
+    }
+    ASSERT_FALSE(mpscr_fifo_summary_test(fifo, 0));
+
+    //lanes are visited in round robin order, starting at lane 0
+    ASSERT_TRUE((node = mpscr_fifo_trypop(fifo)) && node->data == (void*)3);
+    free(node);
+    ASSERT_TRUE((node = mpscr_fifo_trypop(fifo)) && node->data == (void*)64);
+    free(node);
+    ASSERT_TRUE((node = mpscr_fifo_trypop(fifo)) && node->data == (void*)65);
+    free(node);
+    ASSERT_TRUE((node = mpscr_fifo_trypop(fifo)) && node->data == (void*)129);
+    free(node);
+    //the bits of drained lanes are cleared on the next visit
+    ASSERT_NULL(mpscr_fifo_trypop(fifo));
+    for(i = 0; i < num_lanes; ++i) {
+        ASSERT_FALSE(mpscr_fifo_summary_test(fifo, i));
+    }
+
+    mpscr_fifo_destroy(fifo);
+}
+
+CTEST(mpscr_fifo, dynamic)
+{
+    intptr_t i = 0;
+    pthread_t producers[NUM_THREADS];
+    spsc_node_t* node = NULL;
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    fifo = mpscr_fifo_create_ex(DYNAMIC_LANES, MPSCR_FIFO_DYNAMIC);
+    ASSERT_NOT_NULL(fifo);
+
+    for(i = 0; i < DYNAMIC_ROUNDS * DYNAMIC_ROUND_COUNT; ++i) {
+        results[i] = 0;
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_create(&producers[i], NULL, &dynamic_push_func, NULL);
+    }
+
+    pthread_barrier_wait(&barrier);
+
+    for(i = 0; i < DYNAMIC_ROUNDS * DYNAMIC_ROUND_COUNT * (NUM_THREADS-1); ++i) {
+        while(!(node = mpscr_fifo_trypop(fifo))) {
+            sched_yield();
+        }
+        ++results[(intptr_t)node->data];
+        free(node);
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+    }
+
+    for(i = 0; i < DYNAMIC_ROUNDS * DYNAMIC_ROUND_COUNT; ++i) {
+        ASSERT_EQUAL(NUM_THREADS - 1, results[i]);
+    }
+    //every lane is drained and recycled
+    ASSERT_NULL(mpscr_fifo_trypop(fifo));
+    for(i = 0; i < DYNAMIC_LANES; ++i) {
+        ASSERT_EQUAL(MPSCR_FIFO_LANE_FREE, fifo->lanes[i].state);
+    }
+
+    mpscr_fifo_destroy(fifo);
+}
+
+#define ORDERED_COUNT 100000
+
+void* ordered_push_func(void* p)
+{
+    intptr_t thread_id = (intptr_t)p;
+    intptr_t i;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < ORDERED_COUNT; ++i) {
+        mpscr_fifo_ordered_node_t* const node = malloc(sizeof(mpscr_fifo_ordered_node_t));
+        node->node.data = (void*)((thread_id << 32) | i);
+        mpscr_fifo_push_ordered(fifo, (size_t) thread_id, node);
+    }
+    return NULL;
+}
+
+CTEST(mpscr_fifo, ordered)
+{
+    mpscr_fifo_ordered_node_t* node = NULL;
+    const size_t lanes[] = {2, 0, 3, 2, 1, 0};
+    size_t i;
+
+    fifo = mpscr_fifo_create_ex(4, MPSCR_FIFO_ORDERED);
+    ASSERT_NOT_NULL(fifo);
+    ASSERT_NULL(mpscr_fifo_trypop_ordered(fifo));
+    for(i = 0; i < sizeof(lanes) / sizeof(lanes[0]); ++i) {
+        node = malloc(sizeof(mpscr_fifo_ordered_node_t));
+        node->node.data = (void*)i;
+        mpscr_fifo_push_ordered(fifo, lanes[i], node);
+    }
+    //push order across lanes, not round robin
+    for(i = 0; i < sizeof(lanes) / sizeof(lanes[0]); ++i) {
+        node = mpscr_fifo_trypop_ordered(fifo);
+        ASSERT_NOT_NULL(node);
+        ASSERT_TRUE(node->node.data == (void*)i);
+        free(node);
+    }
+    ASSERT_NULL(mpscr_fifo_trypop(fifo));
+    mpscr_fifo_destroy(fifo);
+}
+
+CTEST(mpscr_fifo, ordered_threaded)
+{
+    intptr_t i = 0;
+    pthread_t producers[NUM_THREADS];
+    mpscr_fifo_ordered_node_t* node = NULL;
+    uint64_t last = 0;
+    size_t inversions = 0;
+    intptr_t next[NUM_THREADS];
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    fifo = mpscr_fifo_create_ex(NUM_THREADS-1, MPSCR_FIFO_ORDERED);
+    ASSERT_NOT_NULL(fifo);
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        next[i - 1] = 0;
+        pthread_create(&producers[i], NULL, &ordered_push_func, (void*)(i-1));
+    }
+
+    pthread_barrier_wait(&barrier);
+
+    for(i = 0; i < ORDERED_COUNT * (NUM_THREADS-1); ++i) {
+        intptr_t lane;
+        while(!(node = mpscr_fifo_trypop_ordered(fifo))) {
+            sched_yield();
+        }
+        lane = (intptr_t)node->node.data >> 32;
+        ASSERT_TRUE(lane >= 0 && lane < NUM_THREADS - 1);
+        ASSERT_EQUAL(next[lane], (intptr_t)node->node.data & 0xffffffff);
+        ++next[lane];
+        //an older item shows up late only if it was pushed after the consumer looked at its lane
+        if(node->timestamp < last) {
+            ++inversions;
+        }
+        last = node->timestamp;
+        free(node);
+    }
+    printf("%zu of %d items out of timestamp order\n", inversions, ORDERED_COUNT * (NUM_THREADS-1));
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+    }
+    mpscr_fifo_destroy(fifo);
+}
+
+CTEST(mpscr_fifo, drain_weighted)
+{
+    spsc_node_t* out[8];
+    const size_t weights[3] = {3, 1, 2};
+    intptr_t lane, i;
+    size_t count;
+
+    fifo = mpscr_fifo_create(3);
+    ASSERT_NOT_NULL(fifo);
+    ASSERT_EQUAL(0, mpscr_fifo_drain(fifo, out, 8, weights));
+    for(lane = 0; lane < 2; ++lane) {
+        for(i = 0; i < 10; ++i) {
+            spsc_node_t* const node = malloc(sizeof(spsc_node_t));
+            node->data = (void*)(lane * 100 + i);
+            mpscr_fifo_push(fifo, lane, node);
+        }
+    }
+
+    //lane 0 gets 3 items per visit, lane 1 gets 1, lane 2 is skipped
+    count = mpscr_fifo_drain(fifo, out, 6, weights);
+    ASSERT_EQUAL(6, count);
+    ASSERT_TRUE(out[0]->data == (void*)0);
+    ASSERT_TRUE(out[1]->data == (void*)1);
+    ASSERT_TRUE(out[2]->data == (void*)2);
+    ASSERT_TRUE(out[3]->data == (void*)100);
+    ASSERT_TRUE(out[4]->data == (void*)3);
+    ASSERT_TRUE(out[5]->data == (void*)4);
+    for(i = 0; i < 6; ++i) {
+        free(out[i]);
+    }
+    //the next drain finishes lane 0's quantum first, lane 0 then stops with 2 items of its quantum left
+    count = mpscr_fifo_drain(fifo, out, 3, weights);
+    ASSERT_EQUAL(3, count);
+    ASSERT_TRUE(out[0]->data == (void*)5);
+    ASSERT_TRUE(out[1]->data == (void*)101);
+    ASSERT_TRUE(out[2]->data == (void*)6);
+    for(i = 0; i < 3; ++i) {
+        free(out[i]);
+    }
+    //lane 0 has 2 items of its quantum left, then without weights every lane gets one item per visit
+    count = mpscr_fifo_drain(fifo, out, 4, NULL);
+    ASSERT_EQUAL(4, count);
+    ASSERT_TRUE(out[0]->data == (void*)7);
+    ASSERT_TRUE(out[1]->data == (void*)8);
+    ASSERT_TRUE(out[2]->data == (void*)102);
+    ASSERT_TRUE(out[3]->data == (void*)9);
+    for(i = 0; i < 4; ++i) {
+        free(out[i]);
+    }
+    //the remaining items
+    count = mpscr_fifo_drain(fifo, out, 8, weights);
+    ASSERT_EQUAL(7, count);
+    for(i = 0; i < 7; ++i) {
+        free(out[i]);
+    }
+    ASSERT_EQUAL(0, mpscr_fifo_drain(fifo, out, 8, weights));
+    mpscr_fifo_destroy(fifo);
+}
+
+CTEST(mpscr_fifo, drain_threaded)
+{
+    intptr_t i = 0;
+    pthread_t producers[NUM_THREADS];
+    spsc_node_t* out[64];
+    size_t weights[NUM_THREADS];
+    size_t popped = 0;
+
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    fifo = mpscr_fifo_create(NUM_THREADS-1);
+    ASSERT_NOT_NULL(fifo);
+
+    for(i = 0; i < DYNAMIC_ROUND_COUNT * DYNAMIC_ROUNDS; ++i) {
+        results[i] = 0;
+    }
+    for(i = 1; i < NUM_THREADS; ++i) {
+        weights[i - 1] = (size_t)i * 8;
+        pthread_create(&producers[i], NULL, &drain_push_func, (void*)(i-1));
+    }
+
+    pthread_barrier_wait(&barrier);
+
+    while(popped < (size_t)DYNAMIC_ROUND_COUNT * DYNAMIC_ROUNDS * (NUM_THREADS-1)) {
+        const size_t count = mpscr_fifo_drain(fifo, out, 64, weights);
+        size_t j;
+        if(!count) {
+            sched_yield();
+        }
+        for(j = 0; j < count; ++j) {
+            ++results[(intptr_t)out[j]->data];
+            free(out[j]);
+        }
+        popped += count;
+    }
+
+    for(i = 1; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+    }
+    for(i = 0; i < DYNAMIC_ROUND_COUNT * DYNAMIC_ROUNDS; ++i) {
+        ASSERT_EQUAL(NUM_THREADS - 1, results[i]);
+    }
+    mpscr_fifo_destroy(fifo);
+}
+
 int main(int argc, const char *argv[]) {
+    //opt in before any thread uses the barriers, so pushes run without a fence
+    printf("expedited membarrier: %d\n", asymmetric_barrier_init());
     return ctest_main(argc, argv);
 } /* main */
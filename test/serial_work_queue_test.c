@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <fibconcurrent/serial_work_queue.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 200000
+#define NUM_THREADS 4
+
+typedef struct test_item
+{
+    intptr_t value;
+    mpsc_intrusive_node_t node;
+} test_item_t;
+
+serial_work_queue_t queue;
+pthread_barrier_t barrier;
+volatile int working = 0;
+volatile int exclusion_ok = 1;
+int order_ok = 1;
+int64_t processed = 0;
+intptr_t last_seen[NUM_THREADS];
+test_item_t items[NUM_THREADS][PUSH_COUNT];
+
+CTEST(serial_work_queue, basic)
+{
+    test_item_t local[3];
+    mpsc_intrusive_node_t* node = NULL;
+    intptr_t i;
+
+    serial_work_queue_init(&queue);
+    for(i = 0; i < 3; ++i) {
+        local[i].value = i;
+    }
+    ASSERT_EQUAL(WORK_QUEUE_START_WORKING, serial_work_queue_push(&queue, &local[0].node));
+    ASSERT_EQUAL(WORK_QUEUE_QUEUED, serial_work_queue_push(&queue, &local[1].node));
+    ASSERT_EQUAL(WORK_QUEUE_MORE_WORK, serial_work_queue_get_work(&queue, &node));
+    ASSERT_EQUAL(0, mpsc_intrusive_fifo_entry(node, test_item_t, node)->value);
+    ASSERT_EQUAL(WORK_QUEUE_MORE_WORK, serial_work_queue_get_work(&queue, &node));
+    ASSERT_EQUAL(1, mpsc_intrusive_fifo_entry(node, test_item_t, node)->value);
+    //the worker is still active, so this push is queued
+    ASSERT_EQUAL(WORK_QUEUE_QUEUED, serial_work_queue_push(&queue, &local[2].node));
+    ASSERT_EQUAL(WORK_QUEUE_MORE_WORK, serial_work_queue_get_work(&queue, &node));
+    ASSERT_EQUAL(2, mpsc_intrusive_fifo_entry(node, test_item_t, node)->value);
+    ASSERT_EQUAL(WORK_QUEUE_EMPTY, serial_work_queue_get_work(&queue, &node));
+    //idle again; the next pusher becomes the worker
+    ASSERT_EQUAL(WORK_QUEUE_START_WORKING, serial_work_queue_push(&queue, &local[0].node));
+    ASSERT_EQUAL(WORK_QUEUE_MORE_WORK, serial_work_queue_get_work(&queue, &node));
+    ASSERT_EQUAL(WORK_QUEUE_EMPTY, serial_work_queue_get_work(&queue, &node));
+}
+
+static void claim_worker()
+{
+    if(__sync_lock_test_and_set(&working, 1)) {
+        exclusion_ok = 0;
+    }
+}
+
+void* push_func(void* p)
+{
+    const intptr_t thread = (intptr_t)p;
+    mpsc_intrusive_node_t* node = NULL;
+    intptr_t i;
+
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        test_item_t* const item = &items[thread][i];
+        item->value = thread * PUSH_COUNT + i;
+        if(serial_work_queue_push(&queue, &item->node) == WORK_QUEUE_START_WORKING) {
+            claim_worker();
+            while(1) {
+                //the worker must drop its claim before the queue can go idle
+                __sync_lock_release(&working);
+                if(serial_work_queue_get_work(&queue, &node) == WORK_QUEUE_EMPTY) {
+                    break;
+                }
+                claim_worker();
+                {
+                    const intptr_t value = mpsc_intrusive_fifo_entry(node, test_item_t, node)->value;
+                    const intptr_t t = value / PUSH_COUNT;
+                    if(value % PUSH_COUNT != last_seen[t] + 1) {
+                        order_ok = 0;
+                    }
+                    last_seen[t] = value % PUSH_COUNT;
+                    ++processed;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+CTEST(serial_work_queue, threaded)
+{
+    pthread_t producers[NUM_THREADS];
+    intptr_t i;
+
+    for(i = 0; i < NUM_THREADS; ++i) {
+        last_seen[i] = -1;
+    }
+    serial_work_queue_init(&queue);
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&producers[i], NULL, &push_func, (void*)i);
+    }
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], NULL);
+    }
+    ASSERT_EQUAL(PUSH_COUNT * NUM_THREADS, processed);
+    ASSERT_TRUE(order_ok);
+    ASSERT_TRUE(exclusion_ok);
+}
+
+int main(int argc, const char *argv[])
+{
+    return ctest_main(argc, argv);
+} /* main */
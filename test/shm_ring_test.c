@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <fibconcurrent/shm_ring.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 200000
+#define NUM_PRODUCERS 3
+#define RING_MSG_SIZE ((int)sizeof(message_t))
+
+typedef struct message
+{
+    uint32_t producer;
+    uint32_t seq;
+    char text[16];
+} message_t;
+
+//runs in a child process; returns the exit code
+static int produce(shm_ring_t* r, uint32_t producer)
+{
+    message_t msg;
+    uint32_t i;
+    memset(&msg, 0, sizeof(msg));
+    msg.producer = producer;
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        qerr_t err;
+        msg.seq = i;
+        snprintf(msg.text, sizeof(msg.text), "m%u", i % 1000);
+        while((err = shm_ring_trypush(r, &msg, sizeof(msg))) == QERR_FULL) {
+            sched_yield();
+        }
+        if(err != QERR_OK) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void consume(shm_ring_t* r, int num_producers)
+{
+    uint32_t next[NUM_PRODUCERS];
+    int i;
+    memset(next, 0, sizeof(next));
+    for(i = 0; i < PUSH_COUNT * num_producers; ++i) {
+        message_t msg;
+        size_t len = 0;
+        char expected[16];
+        while(shm_ring_trypop(r, &msg, &len) == QERR_EMPTY) {
+            sched_yield();
+        }
+        ASSERT_EQUAL(sizeof(msg), len);
+        ASSERT_TRUE(msg.producer < (uint32_t)num_producers);
+        //messages from one producer arrive in order
+        ASSERT_EQUAL(next[msg.producer], msg.seq);
+        snprintf(expected, sizeof(expected), "m%u", msg.seq % 1000);
+        ASSERT_STR(expected, msg.text);
+        ++next[msg.producer];
+    }
+}
+
+static void wait_children(int count)
+{
+    int i;
+    for(i = 0; i < count; ++i) {
+        int status = 0;
+        ASSERT_TRUE(wait(&status) > 0);
+        ASSERT_TRUE(WIFEXITED(status));
+        ASSERT_EQUAL(0, WEXITSTATUS(status));
+    }
+}
+
+CTEST(shm_ring, bad_args)
+{
+    shm_ring_t* r = (shm_ring_t*)1;
+    char msg[RING_MSG_SIZE + 1];
+    size_t len;
+    ASSERT_EQUAL(QERR_BADSIZE, shm_ring_create(&r, NULL, SHM_RING_SPSC, 3, RING_MSG_SIZE));
+    ASSERT_NULL(r);
+    ASSERT_EQUAL(QERR_BADSIZE, shm_ring_create(&r, NULL, 0, 4, RING_MSG_SIZE));
+    ASSERT_EQUAL(QERR_BADSIZE, shm_ring_create(&r, NULL, SHM_RING_MPSC, 4, 0));
+
+    ASSERT_EQUAL(QERR_OK, shm_ring_create(&r, NULL, SHM_RING_MPSC, 4, RING_MSG_SIZE));
+    ASSERT_EQUAL(4, shm_ring_capacity(r));
+    ASSERT_EQUAL(RING_MSG_SIZE, shm_ring_msg_size(r));
+    ASSERT_EQUAL(QERR_BADSIZE, shm_ring_trypush(r, msg, sizeof(msg)));
+    ASSERT_EQUAL(QERR_EMPTY, shm_ring_trypop(r, msg, &len));
+    shm_ring_close(r);
+}
+
+CTEST(shm_ring, bad_header)
+{
+    shm_ring_t* r = (shm_ring_t*)1;
+    const int fd = memfd_create("shm_ring_test", MFD_CLOEXEC);
+    ASSERT_TRUE(fd >= 0);
+    ASSERT_EQUAL(QERR_BADFORMAT, shm_ring_attach(&r, fd));
+    ASSERT_NULL(r);
+    //a zero filled object has no magic
+    ASSERT_EQUAL(0, ftruncate(fd, 4096));
+    ASSERT_EQUAL(QERR_BADFORMAT, shm_ring_attach(&r, fd));
+    close(fd);
+}
+
+CTEST(shm_ring, bad_slots_offset)
+{
+    shm_ring_t* r = NULL;
+    shm_ring_t* other = (shm_ring_t*)1;
+    uint64_t slots_offset;
+    ASSERT_EQUAL(QERR_OK, shm_ring_create(&r, NULL, SHM_RING_SPSC, 4, RING_MSG_SIZE));
+    slots_offset = r->header->slots_offset;
+    //past the end of the mapping; (map_size - slots_offset) must not wrap around and pass the capacity check
+    r->header->slots_offset = r->header->map_size + (1ull << 40);
+    ASSERT_EQUAL(QERR_BADFORMAT, shm_ring_attach(&other, shm_ring_fd(r)));
+    ASSERT_NULL(other);
+    r->header->slots_offset = slots_offset;
+    ASSERT_EQUAL(QERR_OK, shm_ring_attach(&other, shm_ring_fd(r)));
+    shm_ring_close(other);
+    shm_ring_close(r);
+}
+
+CTEST(shm_ring, full_empty)
+{
+    shm_ring_t* r = NULL;
+    shm_ring_t* r2 = NULL;
+    uint64_t i, out;
+    size_t len;
+    int mode;
+    for(mode = SHM_RING_SPSC; mode <= SHM_RING_MPSC; ++mode) {
+        ASSERT_EQUAL(QERR_OK, shm_ring_create(&r, NULL, mode, 8, sizeof(i)));
+        ASSERT_EQUAL(QERR_OK, shm_ring_attach(&r2, shm_ring_fd(r)));
+        for(i = 0; i < 8; ++i) {
+            ASSERT_EQUAL(QERR_OK, shm_ring_trypush(r, &i, sizeof(i)));
+        }
+        ASSERT_EQUAL(QERR_FULL, shm_ring_trypush(r, &i, sizeof(i)));
+        //pop from the second mapping
+        for(i = 0; i < 8; ++i) {
+            ASSERT_EQUAL(QERR_OK, shm_ring_trypop(r2, &out, &len));
+            ASSERT_EQUAL(sizeof(out), len);
+            ASSERT_EQUAL(i, out);
+        }
+        ASSERT_EQUAL(QERR_EMPTY, shm_ring_trypop(r2, &out, &len));
+        shm_ring_close(r2);
+        shm_ring_close(r);
+    }
+}
+
+CTEST(shm_ring, spsc_named)
+{
+    char name[64];
+    shm_ring_t* r = NULL;
+    pid_t pid;
+
+    snprintf(name, sizeof(name), "/shm_ring_test.%d", (int)getpid());
+    ASSERT_EQUAL(QERR_OK, shm_ring_create(&r, name, SHM_RING_SPSC, 64, RING_MSG_SIZE));
+
+    pid = fork();
+    ASSERT_TRUE(pid >= 0);
+    if(pid == 0) {
+        shm_ring_t* child = NULL;
+        if(shm_ring_open(&child, name) != QERR_OK) {
+            _exit(2);
+        }
+        _exit(produce(child, 0));
+    }
+
+    consume(r, 1);
+    wait_children(1);
+    ASSERT_TRUE(shm_ring_unlink(name));
+    shm_ring_close(r);
+}
+
+CTEST(shm_ring, mpsc_memfd)
+{
+    shm_ring_t* r = NULL;
+    uint32_t i;
+
+    ASSERT_EQUAL(QERR_OK, shm_ring_create(&r, NULL, SHM_RING_MPSC, 256, RING_MSG_SIZE));
+
+    for(i = 0; i < NUM_PRODUCERS; ++i) {
+        const pid_t pid = fork();
+        ASSERT_TRUE(pid >= 0);
+        if(pid == 0) {
+            shm_ring_t* child = NULL;
+            //the memfd is inherited; attach through it like an unrelated process would
+            if(shm_ring_attach(&child, shm_ring_fd(r)) != QERR_OK) {
+                _exit(2);
+            }
+            _exit(produce(child, i));
+        }
+    }
+
+    consume(r, NUM_PRODUCERS);
+    wait_children(NUM_PRODUCERS);
+    shm_ring_close(r);
+}
+
+int main(int argc, const char *argv[]) {
+    return ctest_main(argc, argv);
+} /* main */
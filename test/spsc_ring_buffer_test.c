@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/spsc_ring_buffer.h>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/time.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 10000000
+#define BATCH 64
+
+pthread_barrier_t barrier;
+spsc_ring_buffer_t* rb;
+
+long long getusecs(struct timeval* tv)
+{
+    return (long long)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+CTEST(spsc_ring_buffer, full_empty)
+{
+    void* in[8] = { (void*)0, (void*)1, (void*)2, (void*)3, (void*)4, (void*)5, (void*)6, (void*)7 };
+    void* out[8];
+    void* d;
+    intptr_t i;
+    spsc_ring_buffer_t* small = spsc_ring_buffer_create(2);
+    ASSERT_NOT_NULL(small);
+
+    ASSERT_FALSE(spsc_ring_buffer_trypop(small, &d));
+    ASSERT_EQUAL_U(0, spsc_ring_buffer_pop_n(small, out, 8));
+    ASSERT_TRUE(spsc_ring_buffer_trypush(small, in[0]));
+    ASSERT_EQUAL_U(3, spsc_ring_buffer_push_n(small, in + 1, 8));
+    ASSERT_FALSE(spsc_ring_buffer_trypush(small, in[4]));
+    ASSERT_EQUAL_U(4, spsc_ring_buffer_size(small));
+    ASSERT_TRUE(spsc_ring_buffer_trypop(small, &d));
+    ASSERT_NULL(d);
+    ASSERT_EQUAL_U(2, spsc_ring_buffer_pop_n(small, out, 2));
+    ASSERT_EQUAL(1, (intptr_t)out[0]);
+    ASSERT_EQUAL(2, (intptr_t)out[1]);
+    //wraps around the end of the buffer
+    ASSERT_EQUAL_U(3, spsc_ring_buffer_push_n(small, in + 4, 4));
+    ASSERT_EQUAL_U(4, spsc_ring_buffer_pop_n(small, out, 8));
+    for(i = 0; i < 4; ++i) {
+        ASSERT_EQUAL(i + 3, (intptr_t)out[i]);
+    }
+    spsc_ring_buffer_destroy(small);
+}
+
+void* pop_func(void* p)
+{
+    intptr_t i = 0;
+    void* out[BATCH];
+    (void) p;
+    pthread_barrier_wait(&barrier);
+    while(i < PUSH_COUNT) {
+        size_t j;
+        size_t n;
+        if(i & 1) {
+            n = spsc_ring_buffer_trypop(rb, out);
+        } else {
+            n = spsc_ring_buffer_pop_n(rb, out, (size_t)(i % BATCH) + 1);
+        }
+        if(!n) {
+            sched_yield();
+        }
+        for(j = 0; j < n; ++j, ++i) {
+            ASSERT_EQUAL(i, (intptr_t)out[j]);
+        }
+    }
+    return NULL;
+}
+
+CTEST(spsc_ring_buffer, threaded)
+{
+    pthread_t consumer;
+    intptr_t i = 0;
+    void* in[BATCH];
+    struct timeval begin, end;
+
+    pthread_barrier_init(&barrier, NULL, 2);
+    rb = spsc_ring_buffer_create(12);
+    ASSERT_NOT_NULL(rb);
+
+    pthread_create(&consumer, NULL, &pop_func, NULL);
+
+    pthread_barrier_wait(&barrier);
+    gettimeofday(&begin, NULL);
+
+    while(i < PUSH_COUNT) {
+        size_t n, j;
+        if(i & 1) {
+            n = spsc_ring_buffer_trypush(rb, (void*)i);
+        } else {
+            n = (size_t)(i % BATCH) + 1;
+            if(n > (size_t)(PUSH_COUNT - i)) {
+                n = (size_t)(PUSH_COUNT - i);
+            }
+            for(j = 0; j < n; ++j) {
+                in[j] = (void*)(i + (intptr_t)j);
+            }
+            n = spsc_ring_buffer_push_n(rb, in, n);
+        }
+        if(!n) {
+            sched_yield();
+        }
+        i += (intptr_t)n;
+    }
+
+    pthread_join(consumer, NULL);
+    gettimeofday(&end, NULL);
+    printf("%d items in %lld us\n", PUSH_COUNT, getusecs(&end) - getusecs(&begin));
+
+    spsc_ring_buffer_destroy(rb);
+}
+
+int main(int argc, const char *argv[]) {
+    return ctest_main(argc, argv);
+} /* main */
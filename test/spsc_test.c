@@ -18,6 +18,7 @@
 
 #include <stdint.h>
 #include <unistd.h>
+#include <sys/time.h>
 
 #include <pthread.h>
 #if !HAVE_PTHREAD_BARRIER
@@ -34,6 +35,11 @@
 pthread_barrier_t barrier;
 spsc_fifo_t fifo;
 
+long long getusecs(struct timeval* tv)
+{
+    return (long long)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
 void* pop_func(void* p)
 {
     intptr_t i;
@@ -52,6 +58,7 @@ CTEST(spsc_fifo, simple)
 {
     pthread_t consumer;
     intptr_t i;
+    struct timeval begin, end;
 
     pthread_barrier_init(&barrier, NULL, 2);
     ASSERT_TRUE(spsc_fifo_init(&fifo));
@@ -59,6 +66,7 @@ CTEST(spsc_fifo, simple)
     pthread_create(&consumer, NULL, &pop_func, NULL);
 
     pthread_barrier_wait(&barrier);
+    gettimeofday(&begin, NULL);
 
     for(i = 0; i < PUSH_COUNT; ++i) {
         spsc_node_t* const node = malloc(sizeof(spsc_node_t));
@@ -67,9 +75,58 @@ CTEST(spsc_fifo, simple)
     }
 
     pthread_join(consumer, NULL);
+    gettimeofday(&end, NULL);
+    printf("malloc/free: %d items in %lld us\n", PUSH_COUNT, getusecs(&end) - getusecs(&begin));
+
+    printf("cleaning...\n");
+    spsc_fifo_destroy(&fifo);
+    pthread_barrier_destroy(&barrier);
+}
+
+void* pop_cached_func(void* p)
+{
+    intptr_t i;
+    void* data = NULL;
+    (void) p;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        while(!spsc_fifo_trypop_cached(&fifo, &data)) {};
+        ASSERT_EQUAL(i, (intptr_t)data);
+    }
+    return NULL;
+}
+
+CTEST(spsc_fifo, node_cache)
+{
+    pthread_t consumer;
+    intptr_t i;
+    size_t nodes = 0;
+    spsc_node_t* node;
+    struct timeval begin, end;
+
+    pthread_barrier_init(&barrier, NULL, 2);
+    ASSERT_TRUE(spsc_fifo_init_cached(&fifo));
+
+    pthread_create(&consumer, NULL, &pop_cached_func, NULL);
+
+    pthread_barrier_wait(&barrier);
+    gettimeofday(&begin, NULL);
+
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        ASSERT_TRUE(spsc_fifo_push_cached(&fifo, (void*)i));
+    }
+
+    pthread_join(consumer, NULL);
+    gettimeofday(&end, NULL);
+
+    for(node = fifo.first; node; node = node->next) {
+        ++nodes;
+    }
+    printf("node cache: %d items in %lld us, %lu nodes allocated\n", PUSH_COUNT, getusecs(&end) - getusecs(&begin), (unsigned long)nodes);
 
     printf("cleaning...\n");
     spsc_fifo_destroy(&fifo);
+    pthread_barrier_destroy(&barrier);
 }
 
 int main(int argc, const char *argv[]) {
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/spsc_unrolled_fifo.h>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 10000000
+
+pthread_barrier_t barrier;
+spsc_unrolled_fifo_t fifo;
+
+long long getusecs(struct timeval* tv)
+{
+    return (long long)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+void* pop_func(void* p)
+{
+    intptr_t i;
+
+    (void) p;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        void* data = NULL;
+        while(!spsc_unrolled_fifo_trypop(&fifo, &data)) {};
+        ASSERT_EQUAL(i, (intptr_t)data);
+    }
+    return NULL;
+}
+
+CTEST(spsc_unrolled_fifo, empty)
+{
+    void* data = (void*)1;
+    ASSERT_TRUE(spsc_unrolled_fifo_init(&fifo));
+    ASSERT_FALSE(spsc_unrolled_fifo_trypop(&fifo, &data));
+    ASSERT_TRUE(data == (void*)1);
+    spsc_unrolled_fifo_destroy(&fifo);
+}
+
+CTEST(spsc_unrolled_fifo, segment_boundaries)
+{
+    intptr_t i, round;
+    void* data = NULL;
+
+    ASSERT_TRUE(spsc_unrolled_fifo_init(&fifo));
+    //fill and drain several segments at a time so drained segments get reused
+    for(round = 0; round < 4; ++round) {
+        for(i = 0; i < UNROLLED_FIFO_SEGMENT_SIZE * 3 + 1; ++i) {
+            ASSERT_TRUE(spsc_unrolled_fifo_push(&fifo, (void*)i));
+        }
+        for(i = 0; i < UNROLLED_FIFO_SEGMENT_SIZE * 3 + 1; ++i) {
+            ASSERT_TRUE(spsc_unrolled_fifo_trypop(&fifo, &data));
+            ASSERT_EQUAL(i, (intptr_t)data);
+        }
+        ASSERT_FALSE(spsc_unrolled_fifo_trypop(&fifo, &data));
+    }
+    spsc_unrolled_fifo_destroy(&fifo);
+}
+
+CTEST(spsc_unrolled_fifo, threaded)
+{
+    pthread_t consumer;
+    struct timeval begin;
+    struct timeval end;
+    intptr_t i;
+
+    pthread_barrier_init(&barrier, NULL, 2);
+    ASSERT_TRUE(spsc_unrolled_fifo_init(&fifo));
+
+    pthread_create(&consumer, NULL, &pop_func, NULL);
+    pthread_barrier_wait(&barrier);
+
+    gettimeofday(&begin, NULL);
+
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        ASSERT_TRUE(spsc_unrolled_fifo_push(&fifo, (void*)i));
+    }
+
+    pthread_join(consumer, NULL);
+    gettimeofday(&end, NULL);
+    printf("unrolled (%d slots per segment): %d items in %lld us\n",
+           UNROLLED_FIFO_SEGMENT_SIZE, PUSH_COUNT, getusecs(&end) - getusecs(&begin));
+
+    printf("cleaning...\n");
+    spsc_unrolled_fifo_destroy(&fifo);
+    pthread_barrier_destroy(&barrier);
+}
+
+int main(int argc, const char *argv[]) {
+    return ctest_main(argc, argv);
+} /* main */
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/spsc_wait_fifo.h>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 1000000
+#define BURST_SIZE 10000
+
+pthread_barrier_t barrier;
+spsc_wait_fifo_t fifo;
+
+long long getusecs(struct timeval* tv)
+{
+    return (long long)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+void* pop_func(void* p)
+{
+    intptr_t i;
+    spsc_node_t* node = NULL;
+    const intptr_t count = (intptr_t)p;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < count; ++i) {
+        node = spsc_wait_fifo_pop(&fifo);
+        ASSERT_NOT_NULL(node);
+        ASSERT_EQUAL(i, (intptr_t)node->data);
+        free(node);
+    }
+    return NULL;
+}
+
+CTEST(spsc_wait_fifo, parks)
+{
+    pthread_t consumer;
+    intptr_t i;
+
+    pthread_barrier_init(&barrier, NULL, 2);
+    ASSERT_TRUE(spsc_wait_fifo_init(&fifo));
+
+    pthread_create(&consumer, NULL, &pop_func, (void*)3);
+    pthread_barrier_wait(&barrier);
+
+    for(i = 0; i < 3; ++i) {
+        spsc_node_t* const node = malloc(sizeof(spsc_node_t));
+        //give the consumer time to run out of spins and wait on the futex
+        usleep(100000);
+        ASSERT_EQUAL(1, fifo.sleeping);
+        node->data = (void*)i;
+        spsc_wait_fifo_push(&fifo, node);
+    }
+
+    pthread_join(consumer, NULL);
+    ASSERT_EQUAL(0, fifo.sleeping);
+    spsc_wait_fifo_destroy(&fifo);
+    pthread_barrier_destroy(&barrier);
+}
+
+CTEST(spsc_wait_fifo, bursts)
+{
+    pthread_t consumer;
+    intptr_t i;
+    struct timeval begin, end;
+
+    pthread_barrier_init(&barrier, NULL, 2);
+    ASSERT_TRUE(spsc_wait_fifo_init(&fifo));
+
+    pthread_create(&consumer, NULL, &pop_func, (void*)PUSH_COUNT);
+    pthread_barrier_wait(&barrier);
+
+    gettimeofday(&begin, NULL);
+
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        spsc_node_t* const node = malloc(sizeof(spsc_node_t));
+        node->data = (void*)i;
+        spsc_wait_fifo_push(&fifo, node);
+        if(i % BURST_SIZE == 0) {
+            //let the consumer drain the FIFO and park
+            usleep(100);
+        }
+    }
+
+    pthread_join(consumer, NULL);
+    gettimeofday(&end, NULL);
+    printf("%d items in %lld us\n", PUSH_COUNT, getusecs(&end) - getusecs(&begin));
+
+    spsc_wait_fifo_destroy(&fifo);
+    pthread_barrier_destroy(&barrier);
+}
+
+int main(int argc, const char *argv[]) {
+    //opt in before any thread uses the barriers
+    printf("expedited membarrier: %d\n", asymmetric_barrier_init());
+    return ctest_main(argc, argv);
+} /* main */
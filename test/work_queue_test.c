@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2012-2015, Brian Watling and other contributors
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fibconcurrent/work_queue.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include <pthread.h>
+#if !HAVE_PTHREAD_BARRIER
+#include "pthread_barrier.h"
+#endif
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include "ctest.h"
+
+#define PUSH_COUNT 200000
+#define BATCH_SIZE 16
+#define NUM_THREADS 4
+
+work_queue_t wq;
+pthread_barrier_t barrier;
+volatile int working = 0;
+int64_t processed = 0;
+intptr_t last_seen[NUM_THREADS];
+int order_ok = 1;
+volatile int exclusion_ok = 1;
+
+static void process_item(work_queue_item_t* item)
+{
+    const intptr_t value = (intptr_t)item->data;
+    const intptr_t thread = value / PUSH_COUNT;
+    const intptr_t seq = value % PUSH_COUNT;
+    if(seq != last_seen[thread] + 1) {
+        order_ok = 0;
+    }
+    last_seen[thread] = seq;
+    ++processed;
+    free(item);
+}
+
+static void do_work_batch()
+{
+    work_queue_item_t* items[BATCH_SIZE];
+    size_t count;
+    size_t i;
+    //only one worker may exist at a time
+    if(__sync_lock_test_and_set(&working, 1)) {
+        exclusion_ok = 0;
+    }
+    while(1) {
+        //the worker must drop its claim before the queue becomes visible as empty
+        __sync_lock_release(&working);
+        count = work_queue_get_work_batch(&wq, items, BATCH_SIZE);
+        if(!count) {
+            break;
+        }
+        if(__sync_lock_test_and_set(&working, 1)) {
+            exclusion_ok = 0;
+        }
+        for(i = 0; i < count; ++i) {
+            process_item(items[i]);
+        }
+    }
+}
+
+void* push_batch_func(void* p)
+{
+    const intptr_t base = (intptr_t)p * PUSH_COUNT;
+    intptr_t i;
+    size_t j;
+
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; i += BATCH_SIZE) {
+        work_queue_item_t* first = NULL;
+        work_queue_item_t* last = NULL;
+        for(j = 0; j < BATCH_SIZE; ++j) {
+            work_queue_item_t* const item = malloc(sizeof(*item));
+            item->data = (void*)(base + i + (intptr_t)j);
+            item->next = NULL;
+            if(last) {
+                last->next = item;
+            } else {
+                first = item;
+            }
+            last = item;
+        }
+        if(work_queue_push_batch(&wq, first, BATCH_SIZE) == WORK_QUEUE_START_WORKING) {
+            do_work_batch();
+        }
+    }
+    return NULL;
+}
+
+CTEST(work_queue, batch_single)
+{
+    work_queue_item_t* items[4];
+    work_queue_item_t* nodes[3];
+    intptr_t i;
+
+    ASSERT_TRUE(work_queue_init(&wq));
+    for(i = 0; i < 3; ++i) {
+        nodes[i] = malloc(sizeof(*nodes[i]));
+        nodes[i]->data = (void*)i;
+        nodes[i]->next = NULL;
+        if(i) {
+            nodes[i - 1]->next = nodes[i];
+        }
+    }
+    ASSERT_EQUAL(WORK_QUEUE_START_WORKING, work_queue_push_batch(&wq, nodes[0], 3));
+    ASSERT_EQUAL(3, work_queue_get_work_batch(&wq, items, 4));
+    for(i = 0; i < 3; ++i) {
+        ASSERT_EQUAL(i, (intptr_t)items[i]->data);
+        free(items[i]);
+    }
+    ASSERT_EQUAL(0, work_queue_get_work_batch(&wq, items, 4));
+    work_queue_destroy(&wq);
+}
+
+CTEST(work_queue, batch_threaded)
+{
+    pthread_t producers[NUM_THREADS];
+    intptr_t i;
+
+    for(i = 0; i < NUM_THREADS; ++i) {
+        last_seen[i] = -1;
+    }
+    processed = 0;
+    order_ok = 1;
+    exclusion_ok = 1;
+    ASSERT_TRUE(work_queue_init(&wq));
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&producers[i], NULL, &push_batch_func, (void*)i);
+    }
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], NULL);
+    }
+    ASSERT_EQUAL(PUSH_COUNT * NUM_THREADS, processed);
+    ASSERT_TRUE(order_ok);
+    ASSERT_TRUE(exclusion_ok);
+    work_queue_destroy(&wq);
+}
+
+static work_queue_item_t* new_item(intptr_t value)
+{
+    work_queue_item_t* const item = malloc(sizeof(*item));
+    item->data = (void*)value;
+    item->next = NULL;
+    return item;
+}
+
+int executor_calls = 0;
+
+static void test_executor(work_queue_t* q, void* arg)
+{
+    (void)arg;
+    if(q == &wq) {
+        ++executor_calls;
+    }
+}
+
+CTEST(work_queue, budget_executor)
+{
+    work_queue_item_t* item = NULL;
+    intptr_t i;
+
+    ASSERT_TRUE(work_queue_init(&wq));
+    work_queue_set_budget(&wq, 2, 0);
+    work_queue_set_executor(&wq, &test_executor, NULL);
+    ASSERT_EQUAL(WORK_QUEUE_START_WORKING, work_queue_push(&wq, new_item(0)));
+    for(i = 1; i < 3; ++i) {
+        ASSERT_EQUAL(WORK_QUEUE_QUEUED, work_queue_push(&wq, new_item(i)));
+    }
+    for(i = 0; i < 2; ++i) {
+        ASSERT_EQUAL(WORK_QUEUE_MORE_WORK, work_queue_get_work(&wq, &item));
+        ASSERT_EQUAL(i, (intptr_t)item->data);
+        free(item);
+    }
+    ASSERT_EQUAL(WORK_QUEUE_HANDOFF, work_queue_get_work(&wq, &item));
+    ASSERT_EQUAL(1, executor_calls);
+    //the executor now owns the queue with a fresh budget
+    ASSERT_EQUAL(WORK_QUEUE_MORE_WORK, work_queue_get_work(&wq, &item));
+    ASSERT_EQUAL(2, (intptr_t)item->data);
+    free(item);
+    ASSERT_EQUAL(WORK_QUEUE_EMPTY, work_queue_get_work(&wq, &item));
+    work_queue_destroy(&wq);
+}
+
+int accept_result = -1;
+intptr_t accept_seen[2];
+int accept_seen_count = 0;
+
+void* accept_func(void* p)
+{
+    work_queue_item_t* item = NULL;
+    (void)p;
+    accept_result = work_queue_push(&wq, new_item(4));
+    if(accept_result == WORK_QUEUE_START_WORKING) {
+        while(work_queue_get_work(&wq, &item) == WORK_QUEUE_MORE_WORK) {
+            if(accept_seen_count < 2) {
+                accept_seen[accept_seen_count] = (intptr_t)item->data;
+            }
+            ++accept_seen_count;
+            free(item);
+        }
+    }
+    return NULL;
+}
+
+CTEST(work_queue, budget_pusher_handoff)
+{
+    work_queue_item_t* item = NULL;
+    pthread_t acceptor;
+    intptr_t i;
+
+    ASSERT_TRUE(work_queue_init(&wq));
+    work_queue_set_budget(&wq, 2, 0);
+    ASSERT_EQUAL(WORK_QUEUE_START_WORKING, work_queue_push(&wq, new_item(0)));
+    for(i = 1; i < 3; ++i) {
+        ASSERT_EQUAL(WORK_QUEUE_QUEUED, work_queue_push(&wq, new_item(i)));
+    }
+    for(i = 0; i < 3; ++i) {
+        ASSERT_EQUAL(WORK_QUEUE_MORE_WORK, work_queue_get_work(&wq, &item));
+        ASSERT_EQUAL(i, (intptr_t)item->data);
+        free(item);
+    }
+    //the budget ran out on the third item, so the queue is on offer. the worker must not take its own offer.
+    ASSERT_EQUAL(WORK_QUEUE_OFFER_OFFERED, wq.offer);
+    ASSERT_EQUAL(WORK_QUEUE_QUEUED, work_queue_push(&wq, new_item(3)));
+    pthread_create(&acceptor, NULL, &accept_func, NULL);
+    while(__atomic_load_n(&wq.offer, __ATOMIC_ACQUIRE) != WORK_QUEUE_OFFER_ACCEPTED) {
+        sched_yield();
+    }
+    ASSERT_EQUAL(WORK_QUEUE_HANDOFF, work_queue_get_work(&wq, &item));
+    pthread_join(acceptor, NULL);
+    ASSERT_EQUAL(WORK_QUEUE_START_WORKING, accept_result);
+    ASSERT_EQUAL(2, accept_seen_count);
+    ASSERT_EQUAL(3, accept_seen[0]);
+    ASSERT_EQUAL(4, accept_seen[1]);
+    work_queue_destroy(&wq);
+}
+
+void* push_budget_func(void* p)
+{
+    const intptr_t base = (intptr_t)p * PUSH_COUNT;
+    work_queue_item_t* item = NULL;
+    intptr_t i;
+
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < PUSH_COUNT; ++i) {
+        if(work_queue_push(&wq, new_item(base + i)) == WORK_QUEUE_START_WORKING) {
+            if(__sync_lock_test_and_set(&working, 1)) {
+                exclusion_ok = 0;
+            }
+            while(1) {
+                __sync_lock_release(&working);
+                if(work_queue_get_work(&wq, &item) != WORK_QUEUE_MORE_WORK) {
+                    break;
+                }
+                if(__sync_lock_test_and_set(&working, 1)) {
+                    exclusion_ok = 0;
+                }
+                process_item(item);
+            }
+        }
+    }
+    return NULL;
+}
+
+CTEST(work_queue, budget_threaded)
+{
+    pthread_t producers[NUM_THREADS];
+    intptr_t i;
+
+    for(i = 0; i < NUM_THREADS; ++i) {
+        last_seen[i] = -1;
+    }
+    processed = 0;
+    order_ok = 1;
+    exclusion_ok = 1;
+    ASSERT_TRUE(work_queue_init(&wq));
+    work_queue_set_budget(&wq, 64, 1000000);
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&producers[i], NULL, &push_budget_func, (void*)i);
+    }
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], NULL);
+    }
+    ASSERT_EQUAL(PUSH_COUNT * NUM_THREADS, processed);
+    ASSERT_TRUE(order_ok);
+    ASSERT_TRUE(exclusion_ok);
+    work_queue_destroy(&wq);
+}
+
+#define EXECUTE_COUNT 100000
+
+int64_t shared_counter = 0;
+volatile int in_critical = 0;
+
+typedef struct add_request
+{
+    int64_t amount;
+    int64_t result;
+} add_request_t;
+
+static void add_fn(void* arg)
+{
+    add_request_t* const req = (add_request_t*)arg;
+    if(__sync_lock_test_and_set(&in_critical, 1)) {
+        exclusion_ok = 0;
+    }
+    shared_counter += req->amount;
+    req->result = shared_counter;
+    __sync_lock_release(&in_critical);
+}
+
+void* execute_func(void* p)
+{
+    intptr_t i;
+    int64_t last_result = 0;
+    add_request_t req;
+
+    (void)p;
+    pthread_barrier_wait(&barrier);
+    for(i = 0; i < EXECUTE_COUNT; ++i) {
+        req.amount = 1;
+        req.result = 0;
+        if(!work_queue_execute(&wq, &add_fn, &req)) {
+            order_ok = 0;
+        }
+        //the counter only grows, so each result must exceed the previous one
+        if(req.result <= last_result) {
+            order_ok = 0;
+        }
+        last_result = req.result;
+    }
+    //the node cache is freed on thread exit
+    return NULL;
+}
+
+CTEST(work_queue, execute)
+{
+    add_request_t req = {5, 0};
+
+    shared_counter = 0;
+    ASSERT_TRUE(work_queue_init(&wq));
+    ASSERT_TRUE(work_queue_execute(&wq, &add_fn, &req));
+    ASSERT_EQUAL(5, req.result);
+    ASSERT_TRUE(work_queue_execute(&wq, &add_fn, &req));
+    ASSERT_EQUAL(10, req.result);
+    work_queue_execute_thread_cleanup();
+    work_queue_destroy(&wq);
+}
+
+CTEST(work_queue, execute_threaded)
+{
+    pthread_t threads[NUM_THREADS];
+    intptr_t i;
+
+    shared_counter = 0;
+    order_ok = 1;
+    exclusion_ok = 1;
+    ASSERT_TRUE(work_queue_init(&wq));
+    work_queue_set_budget(&wq, 256, 0);
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_create(&threads[i], NULL, &execute_func, NULL);
+    }
+    for(i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    ASSERT_EQUAL(EXECUTE_COUNT * NUM_THREADS, shared_counter);
+    ASSERT_TRUE(order_ok);
+    ASSERT_TRUE(exclusion_ok);
+    work_queue_destroy(&wq);
+}
+
+int main(int argc, const char *argv[])
+{
+    return ctest_main(argc, argv);
+} /* main */